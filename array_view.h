@@ -0,0 +1,32 @@
+#ifndef ARRAY_VIEW_H
+#define ARRAY_VIEW_H
+
+#include <cstddef>
+
+namespace SimpleConfig
+{
+
+//Non-owning view of a contiguous array. Valid as long as the object
+//that handed it out is alive and unmodified.
+template<typename T>
+class ArrayView
+{
+public:
+   ArrayView(): mData(NULL), mSize(0) {}
+   ArrayView(const T* data, size_t size): mData(data), mSize(size) {}
+
+   const T* begin() const { return mData; }
+   const T* end() const { return mData + mSize; }
+   const T* data() const { return mData; }
+   size_t size() const { return mSize; }
+   bool empty() const { return mSize == 0; }
+   const T& operator[](size_t i) const { return mData[i]; }
+
+private:
+   const T* mData;
+   size_t mSize;
+};
+
+}
+
+#endif /* ARRAY_VIEW_H */
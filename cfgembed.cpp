@@ -0,0 +1,42 @@
+#include "config_parser.h"
+#include "config_embedder.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstdio>
+
+//Usage: cfgembed input.ini output.cpp symbol
+//Parses input.ini and writes output.cpp defining the EmbeddedTable symbol
+int main(int argc, char* argv[])
+{
+   if(argc != 4)
+   {
+      std::cerr << "Usage: " << argv[0] << " input.ini output.cpp symbol" << std::endl;
+      return 2;
+   }
+
+   try
+   {
+      SimpleConfig::ConfigParser config;
+      config.Parse(argv[1]);
+
+      std::ofstream out(argv[2]);
+      if(!out.is_open())
+      {
+         throw std::runtime_error(std::string("Could not open file ") + argv[2]);
+      }
+      SimpleConfig::WriteEmbeddedConfig(config, argv[3], out);
+      out.close();
+      if(!out)
+      {
+         throw std::runtime_error(std::string("Could not write file ") + argv[2]);
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cerr << argv[1] << ": " << e.what() << std::endl;
+      std::remove(argv[2]);
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,109 @@
+#include "config_lint.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Usage: cfglint [--jobs=N] [--suffix=.ini ...] [--json] path ...
+//Parses every file given, and every file below each directory given
+//(only names ending in a --suffix, if any are given), on N threads
+//(default: one per core). Every error in a file is found in one pass.
+//Writes one diagnostic per line to stdout, as path:line:column: message
+//or, with --json, as one JSON object per line, then a summary with the
+//throughput to stderr.
+//
+//Exit status: 0 if every file parsed, 1 if any did not, 2 on a usage
+//error or an unreadable path.
+
+namespace
+{
+
+bool StartsWith(const char* text, const char* prefix)
+{
+   return std::strncmp(text, prefix, std::strlen(prefix)) == 0;
+}
+
+int Usage(const char* program)
+{
+   std::cerr << "Usage: " << program << " [--jobs=N] [--suffix=.ini ...] [--json] path ..." << std::endl;
+   return 2;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+   unsigned threads = std::thread::hardware_concurrency();
+   std::vector<std::string> suffixes;
+   bool json = false;
+   int i = 1;
+   for(; i < argc && StartsWith(argv[i], "--"); i++)
+   {
+      if(StartsWith(argv[i], "--jobs="))
+      {
+         threads = std::atoi(argv[i] + std::strlen("--jobs="));
+         if(threads == 0)
+         {
+            return Usage(argv[0]);
+         }
+      }
+      else if(StartsWith(argv[i], "--suffix="))
+      {
+         suffixes.push_back(argv[i] + std::strlen("--suffix="));
+      }
+      else if(std::strcmp(argv[i], "--json") == 0)
+      {
+         json = true;
+      }
+      else
+      {
+         return Usage(argv[0]);
+      }
+   }
+   if(i == argc)
+   {
+      return Usage(argv[0]);
+   }
+   if(threads == 0)
+   {
+      threads = 1;
+   }
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   std::vector<std::string> files;
+   try
+   {
+      for(; i < argc; i++)
+      {
+         SimpleConfig::CollectConfigFiles(argv[i], suffixes, files);
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cerr << e.what() << std::endl;
+      return 2;
+   }
+
+   std::vector<SimpleConfig::LintResult> results = SimpleConfig::LintFiles(files, threads);
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   size_t failed = 0;
+   double bytes = 0;
+   for(size_t r = 0; r < results.size(); r++)
+   {
+      SimpleConfig::WriteDiagnostics(results[r], json, std::cout);
+      failed += results[r].diagnostics.empty() ? 0 : 1;
+      bytes += results[r].bytes;
+   }
+   std::cout.flush();
+
+   std::fprintf(stderr, "%lu files, %lu with errors, %.1f MB in %.3f s on %u threads: %.0f files/s, %.1f MB/s\n",
+      static_cast<unsigned long>(results.size()), static_cast<unsigned long>(failed), bytes / 1e6, seconds, threads,
+      seconds > 0 ? results.size() / seconds : 0.0, seconds > 0 ? bytes / 1e6 / seconds : 0.0);
+   return failed ? 1 : 0;
+}
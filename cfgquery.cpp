@@ -0,0 +1,102 @@
+#include "config_parser.h"
+#include "config_query.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Usage: cfgquery [--format=plain|typed|env] [--prefix=NAME] config.ini [section.key ...]
+//Parses config.ini once and answers every query, given as arguments or,
+//when there are none, read from stdin one per line. Values are written
+//one per line in query order, with newlines, carriage returns and
+//backslashes in strings escaped as \n, \r and \\. A miss is reported on
+//stderr and still takes its line: empty, or query<TAB>missing<TAB> with
+//--format=typed. --format=env writes NAME='value' lines for eval, with
+//names prefixed by --prefix, and nothing for a miss.
+//
+//Exit status: 0 if every query was found, otherwise the number of
+//misses (at most 100); 101 if the file could not be parsed, 102 on a
+//usage error.
+
+namespace
+{
+
+const int MAX_MISS_STATUS = 100;
+const int PARSE_FAILED = 101;
+const int USAGE_ERROR = 102;
+
+bool StartsWith(const char* text, const char* prefix)
+{
+   return std::strncmp(text, prefix, std::strlen(prefix)) == 0;
+}
+
+int Usage(const char* program)
+{
+   std::cerr << "Usage: " << program << " [--format=plain|typed|env] [--prefix=NAME] config.ini [section.key ...]" << std::endl;
+   return USAGE_ERROR;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+   SimpleConfig::QueryFormat format = SimpleConfig::PLAIN_FORMAT;
+   std::string prefix;
+   int i = 1;
+   for(; i < argc && StartsWith(argv[i], "--"); i++)
+   {
+      if(std::strcmp(argv[i], "--format=plain") == 0)
+      {
+         format = SimpleConfig::PLAIN_FORMAT;
+      }
+      else if(std::strcmp(argv[i], "--format=typed") == 0)
+      {
+         format = SimpleConfig::TYPED_FORMAT;
+      }
+      else if(std::strcmp(argv[i], "--format=env") == 0)
+      {
+         format = SimpleConfig::ENV_FORMAT;
+      }
+      else if(StartsWith(argv[i], "--prefix="))
+      {
+         prefix = argv[i] + std::strlen("--prefix=");
+      }
+      else
+      {
+         return Usage(argv[0]);
+      }
+   }
+   if(i == argc)
+   {
+      return Usage(argv[0]);
+   }
+   const char* path = argv[i++];
+
+   std::vector<std::string> queries(argv + i, argv + argc);
+   if(queries.empty())
+   {
+      std::string line;
+      while(std::getline(std::cin, line))
+      {
+         if(!line.empty())
+         {
+            queries.push_back(line);
+         }
+      }
+   }
+
+   SimpleConfig::ConfigParser config;
+   try
+   {
+      config.Parse(path);
+   }
+   catch(std::exception& e)
+   {
+      std::cerr << path << ": " << e.what() << std::endl;
+      return PARSE_FAILED;
+   }
+
+   size_t misses = SimpleConfig::RunQueries(config, queries, format, prefix, std::cout, std::cerr);
+   return misses > static_cast<size_t>(MAX_MISS_STATUS) ? MAX_MISS_STATUS : static_cast<int>(misses);
+}
@@ -0,0 +1,306 @@
+#include "compressed_stream.h"
+#include "memory_stream.h"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace SimpleConfig
+{
+
+static const unsigned char gzipMagic[] = {0x1F, 0x8B};
+static const unsigned char zstdMagic[] = {0x28, 0xB5, 0x2F, 0xFD};
+
+static bool StartsWith(const char* data, size_t length, const unsigned char* magic, size_t magicLength)
+{
+   return length >= magicLength && std::memcmp(data, magic, magicLength) == 0;
+}
+
+//Peeks at the bytes the buffer has read ahead, so unseekable sources
+//such as pipes work too
+Compression DetectCompression(std::streambuf* source)
+{
+   if(source->sgetc() == std::char_traits<char>::eof())
+   {
+      return NO_COMPRESSION;
+   }
+   const char* head = BufferedBytes::Begin(source);
+   size_t length = BufferedBytes::End(source) - head;
+   if(StartsWith(head, length, gzipMagic, sizeof(gzipMagic)))
+   {
+      return GZIP_COMPRESSION;
+   }
+   if(StartsWith(head, length, zstdMagic, sizeof(zstdMagic)))
+   {
+      return ZSTD_COMPRESSION;
+   }
+   return NO_COMPRESSION;
+}
+
+//Ends the zlib stream on every way out of Gunzip
+class InflateEnder
+{
+public:
+   explicit InflateEnder(z_stream* stream): mStream(stream) {}
+   ~InflateEnder() { inflateEnd(mStream); }
+
+private:
+   z_stream* mStream;
+};
+
+
+DecompressingStreamBuf::DecompressingStreamBuf(std::streambuf* compressed, Compression compression,
+   size_t bufferSize /* =DEFAULT_BUFFER_SIZE */):
+   mCompressed(compressed), mCompression(compression), mInput(bufferSize), mFilling(0), mReading(-1),
+   mFinished(false), mStop(false)
+{
+   for(int i = 0; i < 2; i++)
+   {
+      mBuffers[i].resize(bufferSize);
+      mLengths[i] = 0;
+      mFull[i] = false;
+   }
+   setg(NULL, NULL, NULL);
+   mThread = std::thread(&DecompressingStreamBuf::Run, this);
+}
+
+DecompressingStreamBuf::~DecompressingStreamBuf()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+   }
+   mChanged.notify_all();
+   mThread.join();
+}
+
+//Hands the buffer just read back to the thread and waits for the next
+std::streambuf::int_type DecompressingStreamBuf::underflow()
+{
+   std::unique_lock<std::mutex> lock(mMutex);
+   int next = 0;
+   if(mReading >= 0)
+   {
+      mFull[mReading] = false;
+      next = 1 - mReading;
+      mReading = -1;
+      setg(NULL, NULL, NULL);
+      mChanged.notify_all();
+   }
+
+   while(!mFull[next] && !mFinished)
+   {
+      mChanged.wait(lock);
+   }
+   if(!mFull[next])
+   {
+      if(mError)
+      {
+         std::rethrow_exception(mError);
+      }
+      return traits_type::eof();
+   }
+
+   mReading = next;
+   char* data = &mBuffers[next][0];
+   setg(data, data, data + mLengths[next]);
+   return traits_type::to_int_type(*gptr());
+}
+
+void DecompressingStreamBuf::Run()
+{
+   try
+   {
+      if(mCompression == GZIP_COMPRESSION)
+      {
+         Gunzip();
+      }
+      else
+      {
+         Unzstd();
+      }
+   }
+   catch(...)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mError = std::current_exception();
+   }
+
+   std::lock_guard<std::mutex> lock(mMutex);
+   mFinished = true;
+   mChanged.notify_all();
+}
+
+size_t DecompressingStreamBuf::ReadCompressed()
+{
+   std::streamsize count = mCompressed->sgetn(&mInput[0], mInput.size());
+   return count > 0 ? static_cast<size_t>(count) : 0;
+}
+
+//Publishes length bytes of the buffer being filled and returns the
+//other one once the reader is done with it, or NULL when stopping
+char* DecompressingStreamBuf::Deliver(size_t length)
+{
+   std::unique_lock<std::mutex> lock(mMutex);
+   mLengths[mFilling] = length;
+   mFull[mFilling] = true;
+   mChanged.notify_all();
+
+   mFilling = 1 - mFilling;
+   while(mFull[mFilling] && !mStop)
+   {
+      mChanged.wait(lock);
+   }
+   return mStop ? NULL : &mBuffers[mFilling][0];
+}
+
+void DecompressingStreamBuf::Gunzip()
+{
+   z_stream stream;
+   std::memset(&stream, 0, sizeof(stream));
+   //15 window bits, +32 to accept gzip and zlib headers
+   if(inflateInit2(&stream, 15 + 32) != Z_OK)
+   {
+      throw std::runtime_error("Could not start gzip decompression");
+   }
+   InflateEnder ender(&stream);
+
+   size_t size = mBuffers[0].size();
+   char* out = &mBuffers[mFilling][0];
+   stream.next_out = reinterpret_cast<Bytef*>(out);
+   stream.avail_out = size;
+   bool memberEnded = false;
+   bool inputEnded = false;
+   while(true)
+   {
+      if(stream.avail_in == 0 && !inputEnded)
+      {
+         size_t count = ReadCompressed();
+         inputEnded = (count == 0);
+         stream.next_in = reinterpret_cast<Bytef*>(&mInput[0]);
+         stream.avail_in = count;
+      }
+      if(memberEnded)
+      {
+         if(stream.avail_in == 0)
+         {
+            break;
+         }
+         //Concatenated members, as written by cat a.gz b.gz
+         inflateReset(&stream);
+         memberEnded = false;
+      }
+
+      //Without new input, inflate may still have buffered output to give
+      uInt room = stream.avail_out;
+      int result = inflate(&stream, Z_NO_FLUSH);
+      if(result == Z_STREAM_END)
+      {
+         memberEnded = true;
+      }
+      else if(result != Z_OK && result != Z_BUF_ERROR)
+      {
+         throw std::runtime_error(std::string("Corrupt gzip data: ") + (stream.msg ? stream.msg : "unknown error"));
+      }
+      else if(inputEnded && stream.avail_out == room)
+      {
+         throw std::runtime_error("Truncated gzip data");
+      }
+
+      if(stream.avail_out == 0)
+      {
+         out = Deliver(size);
+         if(!out)
+         {
+            return;
+         }
+         stream.next_out = reinterpret_cast<Bytef*>(out);
+         stream.avail_out = size;
+      }
+   }
+
+   if(stream.avail_out < size)
+   {
+      Deliver(size - stream.avail_out);
+   }
+}
+
+#ifdef HAVE_ZSTD
+//Frees the zstd stream on every way out of Unzstd
+class ZstdFreer
+{
+public:
+   explicit ZstdFreer(ZSTD_DStream* stream): mStream(stream) {}
+   ~ZstdFreer() { ZSTD_freeDStream(mStream); }
+
+private:
+   ZSTD_DStream* mStream;
+};
+
+void DecompressingStreamBuf::Unzstd()
+{
+   ZSTD_DStream* stream = ZSTD_createDStream();
+   if(!stream)
+   {
+      throw std::runtime_error("Could not start zstd decompression");
+   }
+   ZstdFreer freer(stream);
+
+   size_t size = mBuffers[0].size();
+   ZSTD_outBuffer out = {&mBuffers[mFilling][0], size, 0};
+   ZSTD_inBuffer in = {&mInput[0], 0, 0};
+   size_t pending = 1; //Non-zero while a frame is incomplete
+   bool inputEnded = false;
+   while(true)
+   {
+      if(in.pos == in.size && !inputEnded)
+      {
+         in.size = ReadCompressed();
+         in.pos = 0;
+         inputEnded = (in.size == 0);
+      }
+      if(inputEnded && pending == 0)
+      {
+         break;
+      }
+
+      //Without new input, zstd may still have buffered output to give
+      size_t written = out.pos;
+      pending = ZSTD_decompressStream(stream, &out, &in);
+      if(ZSTD_isError(pending))
+      {
+         throw std::runtime_error(std::string("Corrupt zstd data: ") + ZSTD_getErrorName(pending));
+      }
+      if(inputEnded && pending != 0 && out.pos == written)
+      {
+         throw std::runtime_error("Truncated zstd data");
+      }
+
+      if(out.pos == out.size)
+      {
+         char* next = Deliver(size);
+         if(!next)
+         {
+            return;
+         }
+         out.dst = next;
+         out.pos = 0;
+      }
+   }
+
+   if(out.pos > 0)
+   {
+      Deliver(out.pos);
+   }
+}
+#else
+void DecompressingStreamBuf::Unzstd()
+{
+   throw std::runtime_error("zstd compressed input, but built without zstd support (HAVE_ZSTD)");
+}
+#endif
+
+}
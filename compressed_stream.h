@@ -0,0 +1,75 @@
+#ifndef COMPRESSED_STREAM_H
+#define COMPRESSED_STREAM_H
+
+#include <streambuf>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstddef>
+
+namespace SimpleConfig
+{
+
+typedef enum compression
+{
+   NO_COMPRESSION, GZIP_COMPRESSION, ZSTD_COMPRESSION
+} Compression;
+
+//Looks at the magic bytes at the start of source without consuming them
+Compression DetectCompression(std::streambuf* source);
+
+
+//Read-only stream buffer over the decompressed contents of another
+//stream buffer. A background thread decompresses into two fixed-size
+//buffers in turn, so decompression overlaps with whatever reads this
+//buffer and memory use does not grow with the input.
+//
+//Corrupt or truncated input is reported by underflow throwing
+//std::runtime_error; set badbit in the exceptions mask of the reading
+//istream so the error is not turned into a silent end of input.
+//
+//zstd needs the build to define HAVE_ZSTD and link -lzstd; without it,
+//zstd input fails with std::runtime_error.
+class DecompressingStreamBuf : public std::streambuf
+{
+public:
+   static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+   DecompressingStreamBuf(std::streambuf* compressed, Compression compression, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+   ~DecompressingStreamBuf();
+
+protected:
+   virtual int_type underflow();
+
+private:
+   DecompressingStreamBuf(const DecompressingStreamBuf&);
+   DecompressingStreamBuf& operator=(const DecompressingStreamBuf&);
+
+   void Run();
+   void Gunzip();
+   void Unzstd();
+   size_t ReadCompressed();
+   char* Deliver(size_t length);
+
+   std::streambuf* mCompressed;
+   Compression mCompression;
+   std::vector<char> mInput;
+   std::vector<char> mBuffers[2];
+   size_t mLengths[2];
+   bool mFull[2];
+   int mFilling; //Buffer the thread writes next
+   int mReading; //Buffer the get area is in, or -1
+
+   bool mFinished;
+   bool mStop;
+   std::exception_ptr mError;
+   std::mutex mMutex;
+   std::condition_variable mChanged;
+   std::thread mThread;
+};
+
+}
+
+#endif /* COMPRESSED_STREAM_H */
@@ -0,0 +1,176 @@
+#include "compressed_stream.h"
+#include "config_parser.h"
+#include "memory_stream.h"
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace
+{
+
+std::string Gzip(const std::string& text)
+{
+   z_stream stream;
+   std::memset(&stream, 0, sizeof(stream));
+   //15 window bits, +16 for a gzip header
+   deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+   std::string out(deflateBound(&stream, text.size()), '\0');
+   stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+   stream.avail_in = text.size();
+   stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+   stream.avail_out = out.size();
+   deflate(&stream, Z_FINISH);
+   out.resize(stream.total_out);
+   deflateEnd(&stream);
+   return out;
+}
+
+std::string Decompress(const std::string& compressed, size_t bufferSize)
+{
+   SimpleConfig::MemoryStreamBuf raw(compressed.data(), compressed.size());
+   SimpleConfig::DecompressingStreamBuf buf(&raw, SimpleConfig::DetectCompression(&raw), bufferSize);
+   std::istream stream(&buf);
+   stream.exceptions(std::ios_base::badbit);
+   std::string out;
+   char c;
+   while(stream.get(c))
+   {
+      out += c;
+   }
+   return out;
+}
+
+std::string GeneratedConfig(int sections)
+{
+   std::ostringstream out;
+   for(int s = 0; s < sections; s++)
+   {
+      out << "[section" << s << "]\n";
+      for(int k = 0; k < 20; k++)
+      {
+         out << "key" << k << " = " << s * 100 + k << "\n";
+         out << "path" << k << " = \"/srv/" << s << "/" << k << "\"\n";
+      }
+   }
+   return out.str();
+}
+
+class CompressedStreamTest : public ::testing::Test
+{
+protected:
+
+   ~CompressedStreamTest()
+   {
+      for(size_t i = 0; i < files.size(); i++)
+      {
+         remove(files[i].c_str());
+      }
+   }
+
+   std::string WriteFile(const std::string& contents)
+   {
+      char path[] = "/tmp/compressed_stream_testXXXXXX";
+      int fd = mkstemp(path);
+      close(fd);
+      std::ofstream file(path, std::ios_base::binary);
+      file << contents;
+      files.push_back(path);
+      return path;
+   }
+
+   std::vector<std::string> files;
+};
+
+TEST(DetectCompressionTest, MagicBytesRecognised)
+{
+   std::string gzip = Gzip("a=1\n");
+   SimpleConfig::MemoryStreamBuf gzipBuf(gzip.data(), gzip.size());
+   EXPECT_EQ(SimpleConfig::GZIP_COMPRESSION, SimpleConfig::DetectCompression(&gzipBuf));
+   EXPECT_EQ('\x1F', gzipBuf.sgetc()); //Nothing consumed
+
+   const char zstd[] = "\x28\xB5\x2F\xFD\x00";
+   SimpleConfig::MemoryStreamBuf zstdBuf(zstd, sizeof(zstd) - 1);
+   EXPECT_EQ(SimpleConfig::ZSTD_COMPRESSION, SimpleConfig::DetectCompression(&zstdBuf));
+
+   SimpleConfig::MemoryStreamBuf plainBuf("a=1\n", 4);
+   EXPECT_EQ(SimpleConfig::NO_COMPRESSION, SimpleConfig::DetectCompression(&plainBuf));
+   SimpleConfig::MemoryStreamBuf emptyBuf("", 0);
+   EXPECT_EQ(SimpleConfig::NO_COMPRESSION, SimpleConfig::DetectCompression(&emptyBuf));
+}
+
+//Tiny buffers make the two threads hand buffers back and forth often
+TEST(DecompressingStreamBufTest, ContentsSurviveAnyBufferSize)
+{
+   std::string text = GeneratedConfig(50);
+   std::string gzip = Gzip(text);
+   size_t sizes[] = {1, 7, 4096, SimpleConfig::DecompressingStreamBuf::DEFAULT_BUFFER_SIZE};
+   for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      EXPECT_EQ(text, Decompress(gzip, sizes[i])) << sizes[i];
+   }
+}
+
+TEST(DecompressingStreamBufTest, ConcatenatedMembersJoined)
+{
+   EXPECT_EQ("a=1\nb=2\n", Decompress(Gzip("a=1\n") + Gzip("b=2\n"), 16));
+}
+
+TEST(DecompressingStreamBufTest, DamagedInputThrows)
+{
+   std::string gzip = Gzip(GeneratedConfig(5));
+   EXPECT_THROW(Decompress(gzip.substr(0, gzip.size() / 2), 64), std::runtime_error);
+
+   std::string corrupt = gzip;
+   corrupt[gzip.size() / 2] ^= 0x55;
+   corrupt[gzip.size() / 2 + 1] ^= 0x55;
+   EXPECT_THROW(Decompress(corrupt, 64), std::runtime_error);
+}
+
+//A reader that stops early must not leave the thread waiting
+TEST(DecompressingStreamBufTest, ReaderMayStopEarly)
+{
+   std::string gzip = Gzip(GeneratedConfig(50));
+   SimpleConfig::MemoryStreamBuf raw(gzip.data(), gzip.size());
+   SimpleConfig::DecompressingStreamBuf buf(&raw, SimpleConfig::GZIP_COMPRESSION, 32);
+   EXPECT_EQ('[', buf.sbumpc());
+}
+
+TEST_F(CompressedStreamTest, ParseReadsGzipFiles)
+{
+   std::string text = GeneratedConfig(30);
+   std::string path = WriteFile(Gzip(text));
+
+   SimpleConfig::ConfigParser compressed;
+   compressed.Parse(path);
+   SimpleConfig::ConfigParser plain;
+   plain.Parse(WriteFile(text));
+
+   EXPECT_EQ(2919, compressed.LookupInteger("section29", "key19"));
+   EXPECT_EQ("/srv/29/19", compressed.LookupString("section29", "path19"));
+   EXPECT_EQ(plain.Lookup("section17", "path3").lineNum, compressed.Lookup("section17", "path3").lineNum);
+}
+
+TEST_F(CompressedStreamTest, ParseReportsDamagedFiles)
+{
+   std::string gzip = Gzip(GeneratedConfig(30));
+   SimpleConfig::ConfigParser c;
+   EXPECT_THROW(c.Parse(WriteFile(gzip.substr(0, gzip.size() - 8))), std::runtime_error);
+   EXPECT_THROW(c.Parse(WriteFile("\x28\xB5\x2F\xFD garbage")), std::runtime_error);
+}
+
+TEST_F(CompressedStreamTest, CompressedIncludesWork)
+{
+   std::string included = WriteFile(Gzip("shared = 5\n"));
+   SimpleConfig::ConfigParser c;
+   std::istringstream configStream("[S]\ninclude \"" + included + "\"\nown = 1\n");
+   c.Parse(configStream);
+   EXPECT_EQ(5, c.LookupInteger("S", "shared"));
+   EXPECT_EQ(1, c.LookupInteger("S", "own"));
+}
+
+}
@@ -0,0 +1,103 @@
+#include "config_diff.h"
+#include "config_parser.h"
+
+namespace SimpleConfig
+{
+
+typedef ConfigParser::KeyIndex KeyMap;
+typedef ConfigParser::SectionIndex SectionMap;
+
+static ConfigChange MakeChange(ChangeType type, const std::string& section, const std::string& key)
+{
+   ConfigChange change;
+   change.type = type;
+   change.section = section;
+   change.key = key;
+   change.oldValue.type = END_OF_FILE;
+   change.oldValue.lineNum = 0;
+   change.newValue.type = END_OF_FILE;
+   change.newValue.lineNum = 0;
+   return change;
+}
+
+static void AddWholeSection(std::vector<ConfigChange>& changes, const ValueStore& values, const SectionMap::const_iterator& sectionIt, bool added)
+{
+   changes.push_back(MakeChange(added ? SECTION_ADDED : SECTION_REMOVED, sectionIt->first, ""));
+   for(KeyMap::const_iterator keyIt = sectionIt->second.begin(); keyIt != sectionIt->second.end(); ++keyIt)
+   {
+      changes.push_back(MakeChange(added ? KEY_ADDED : KEY_REMOVED, sectionIt->first, keyIt->first));
+      if(added)
+      {
+         changes.back().newValue = values.Get(keyIt->second);
+      }
+      else
+      {
+         changes.back().oldValue = values.Get(keyIt->second);
+      }
+   }
+}
+
+static void DiffSection(std::vector<ConfigChange>& changes, const std::string& section,
+   const ValueStore& beforeValues, const KeyMap& before, const ValueStore& afterValues, const KeyMap& after)
+{
+   KeyMap::const_iterator oldIt = before.begin();
+   KeyMap::const_iterator newIt = after.begin();
+
+   while(oldIt != before.end() || newIt != after.end())
+   {
+      if(newIt == after.end() || (oldIt != before.end() && oldIt->first < newIt->first))
+      {
+         changes.push_back(MakeChange(KEY_REMOVED, section, oldIt->first));
+         changes.back().oldValue = beforeValues.Get(oldIt->second);
+         ++oldIt;
+      }
+      else if(oldIt == before.end() || newIt->first < oldIt->first)
+      {
+         changes.push_back(MakeChange(KEY_ADDED, section, newIt->first));
+         changes.back().newValue = afterValues.Get(newIt->second);
+         ++newIt;
+      }
+      else
+      {
+         if(!beforeValues.Equals(oldIt->second, afterValues, newIt->second))
+         {
+            changes.push_back(MakeChange(KEY_CHANGED, section, oldIt->first));
+            changes.back().oldValue = beforeValues.Get(oldIt->second);
+            changes.back().newValue = afterValues.Get(newIt->second);
+         }
+         ++oldIt;
+         ++newIt;
+      }
+   }
+}
+
+std::vector<ConfigChange> DiffConfigs(const ConfigParser& before, const ConfigParser& after)
+{
+   std::vector<ConfigChange> changes;
+   SectionMap::const_iterator oldIt = before.parseMap.begin();
+   SectionMap::const_iterator newIt = after.parseMap.begin();
+
+   while(oldIt != before.parseMap.end() || newIt != after.parseMap.end())
+   {
+      if(newIt == after.parseMap.end() || (oldIt != before.parseMap.end() && oldIt->first < newIt->first))
+      {
+         AddWholeSection(changes, before.mValues, oldIt, false);
+         ++oldIt;
+      }
+      else if(oldIt == before.parseMap.end() || newIt->first < oldIt->first)
+      {
+         AddWholeSection(changes, after.mValues, newIt, true);
+         ++newIt;
+      }
+      else
+      {
+         DiffSection(changes, oldIt->first, before.mValues, oldIt->second, after.mValues, newIt->second);
+         ++oldIt;
+         ++newIt;
+      }
+   }
+
+   return changes;
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef CONFIG_DIFF_H
+#define CONFIG_DIFF_H
+
+#include <string>
+#include <vector>
+#include "config_lexer.h"
+
+namespace SimpleConfig
+{
+
+class ConfigParser;
+
+typedef enum changeType
+{
+   SECTION_ADDED, SECTION_REMOVED,
+   KEY_ADDED, KEY_REMOVED, KEY_CHANGED
+} ChangeType;
+
+//A single difference between two parsed configs.
+//Section level changes leave key empty and carry no values; they are
+//followed by a KEY_ADDED/KEY_REMOVED entry for every key of the section.
+//oldValue is only meaningful for KEY_REMOVED/KEY_CHANGED, newValue only
+//for KEY_ADDED/KEY_CHANGED. Both keep the type and source line of the value.
+typedef struct configChange
+{
+   ChangeType type;
+   std::string section;
+   std::string key;
+   Token oldValue;
+   Token newValue;
+} ConfigChange;
+
+//Compares two parsed configs. Sections and keys are stored sorted, so
+//this is a single merge walk, linear in the size of both configs.
+//Changes are reported in section, then key order.
+std::vector<ConfigChange> DiffConfigs(const ConfigParser& before, const ConfigParser& after);
+
+}
+
+#endif /* CONFIG_DIFF_H */
@@ -0,0 +1,83 @@
+#include "config_diff.h"
+#include "config_parser.h"
+#include "gtest/gtest.h"
+#include <sstream>
+
+namespace
+{
+
+class ConfigDiffTest : public ::testing::Test
+{
+protected:
+
+   void ParseBoth(const std::string& beforeText, const std::string& afterText)
+   {
+      std::istringstream beforeStream(beforeText);
+      std::istringstream afterStream(afterText);
+      before.Parse(beforeStream);
+      after.Parse(afterStream);
+   }
+
+   SimpleConfig::ConfigParser before;
+   SimpleConfig::ConfigParser after;
+};
+
+TEST_F(ConfigDiffTest, IdenticalConfigsHaveNoChanges)
+{
+   ParseBoth("a=1\n[S]\nb=\"x\"\n", "a=1\n[S]\nb=\"x\"\n");
+   EXPECT_TRUE(SimpleConfig::DiffConfigs(before, after).empty());
+}
+
+TEST_F(ConfigDiffTest, ChangedValueReported)
+{
+   ParseBoth("a=1\nb=2\n", "a=1\n\nb=3\n");
+   std::vector<SimpleConfig::ConfigChange> changes = SimpleConfig::DiffConfigs(before, after);
+   ASSERT_EQ(1u, changes.size());
+   EXPECT_EQ(SimpleConfig::KEY_CHANGED, changes[0].type);
+   EXPECT_EQ("", changes[0].section);
+   EXPECT_EQ("b", changes[0].key);
+   EXPECT_EQ("2", changes[0].oldValue.lexeme);
+   EXPECT_EQ(2, changes[0].oldValue.lineNum);
+   EXPECT_EQ("3", changes[0].newValue.lexeme);
+   EXPECT_EQ(3, changes[0].newValue.lineNum);
+}
+
+TEST_F(ConfigDiffTest, TypeChangeReported)
+{
+   ParseBoth("a=1\n", "a=\"1\"\n");
+   std::vector<SimpleConfig::ConfigChange> changes = SimpleConfig::DiffConfigs(before, after);
+   ASSERT_EQ(1u, changes.size());
+   EXPECT_EQ(SimpleConfig::KEY_CHANGED, changes[0].type);
+   EXPECT_EQ(SimpleConfig::INTEGER, changes[0].oldValue.type);
+   EXPECT_EQ(SimpleConfig::STRING, changes[0].newValue.type);
+}
+
+TEST_F(ConfigDiffTest, AddedAndRemovedKeysReported)
+{
+   ParseBoth("a=1\nb=2\n", "b=2\nc=3\n");
+   std::vector<SimpleConfig::ConfigChange> changes = SimpleConfig::DiffConfigs(before, after);
+   ASSERT_EQ(2u, changes.size());
+   EXPECT_EQ(SimpleConfig::KEY_REMOVED, changes[0].type);
+   EXPECT_EQ("a", changes[0].key);
+   EXPECT_EQ(SimpleConfig::KEY_ADDED, changes[1].type);
+   EXPECT_EQ("c", changes[1].key);
+   EXPECT_EQ("3", changes[1].newValue.lexeme);
+}
+
+TEST_F(ConfigDiffTest, AddedAndRemovedSectionsReported)
+{
+   ParseBoth("[Old]\nx=1\n", "[New]\ny=true\n");
+   std::vector<SimpleConfig::ConfigChange> changes = SimpleConfig::DiffConfigs(before, after);
+   ASSERT_EQ(4u, changes.size());
+   EXPECT_EQ(SimpleConfig::SECTION_ADDED, changes[0].type);
+   EXPECT_EQ("New", changes[0].section);
+   EXPECT_EQ(SimpleConfig::KEY_ADDED, changes[1].type);
+   EXPECT_EQ("y", changes[1].key);
+   EXPECT_EQ(SimpleConfig::BOOL, changes[1].newValue.type);
+   EXPECT_EQ(SimpleConfig::SECTION_REMOVED, changes[2].type);
+   EXPECT_EQ("Old", changes[2].section);
+   EXPECT_EQ(SimpleConfig::KEY_REMOVED, changes[3].type);
+   EXPECT_EQ("x", changes[3].key);
+}
+
+}
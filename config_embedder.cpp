@@ -0,0 +1,149 @@
+#include "config_embedder.h"
+#include "config_parser.h"
+#include "embedded_config.h"
+#include <cstdio>
+#include <climits>
+#include <vector>
+
+namespace SimpleConfig
+{
+
+typedef ConfigParser::KeyIndex KeyMap;
+
+static const char* TypeName(TokenType type)
+{
+   switch(type)
+   {
+   case INTEGER:
+      return "SimpleConfig::INTEGER";
+   case REAL_NUMBER:
+      return "SimpleConfig::REAL_NUMBER";
+   case BOOL:
+      return "SimpleConfig::BOOL";
+   case LIST:
+      return "SimpleConfig::LIST";
+   default:
+      return "SimpleConfig::STRING";
+   }
+}
+
+//Octal escapes are always three digits, so a following digit cannot
+//extend them
+static std::string Literal(const std::string& text)
+{
+   std::string out = "\"";
+   for(size_t i = 0; i < text.size(); i++)
+   {
+      unsigned char c = text[i];
+      if(c == '"' || c == '\\')
+      {
+         out += '\\';
+         out += c;
+      }
+      else if(c < 0x20 || c >= 0x7F || c == '?')
+      {
+         char escape[5];
+         std::snprintf(escape, sizeof(escape), "\\%03o", c);
+         out += escape;
+      }
+      else
+      {
+         out += c;
+      }
+   }
+   return out + "\"";
+}
+
+static std::string IntegerLiteral(long long i)
+{
+   if(i == LLONG_MIN)
+   {
+      return "(-9223372036854775807LL - 1)";
+   }
+   char buf[32];
+   std::snprintf(buf, sizeof(buf), "%lldLL", i);
+   return buf;
+}
+
+static std::string RealLiteral(double d)
+{
+   char buf[40];
+   std::snprintf(buf, sizeof(buf), "%.17g", d);
+   std::string literal = buf;
+   if(literal.find_first_of(".en") == std::string::npos)
+   {
+      literal += ".0";
+   }
+   return literal;
+}
+
+void WriteEmbeddedConfig(const ConfigParser& config, const std::string& symbol, std::ostream& out)
+{
+   std::map<std::string, const KeyMap*> sections;
+   config.VisibleSections(sections);
+
+   out << "//Generated by cfgembed. Do not edit.\n";
+   out << "#include \"embedded_config.h\"\n\n";
+   out << "namespace\n{\n\n";
+
+   std::vector<unsigned int> hashes;
+   out << "constexpr SimpleConfig::EmbeddedEntry entries[] =\n{\n";
+   for(std::map<std::string, const KeyMap*>::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      for(KeyMap::const_iterator keyIt = sectionIt->second->begin(); keyIt != sectionIt->second->end(); ++keyIt)
+      {
+         const Value& cell = config.mValues.Cell(keyIt->second);
+         bool converted = cell.GetStorage() == Value::NUMBER_BITS || cell.GetStorage() == Value::REAL_BITS;
+         long long integer = cell.GetStorage() == Value::NUMBER_BITS ? cell.Integer() : 0;
+         double real = cell.GetStorage() == Value::REAL_BITS ? cell.Real() : 0.0;
+
+         out << "   {" << Literal(sectionIt->first) << ", " << Literal(keyIt->first) << ", "
+             << TypeName(cell.Type()) << ", " << Literal(config.mValues.Text(keyIt->second)) << ", "
+             << (converted ? "true" : "false") << ", " << IntegerLiteral(integer) << ", "
+             << RealLiteral(real) << ", " << config.mValues.Line(keyIt->second) << "},\n";
+
+         hashes.push_back(EmbeddedHash(sectionIt->first.data(), sectionIt->first.size(),
+            keyIt->first.data(), keyIt->first.size()));
+      }
+   }
+   if(hashes.empty())
+   {
+      out << "   {\"\", \"\", SimpleConfig::STRING, \"\", false, 0LL, 0.0, 0}\n";
+   }
+   out << "};\n\n";
+
+   //At most half full, so probe sequences stay short
+   size_t slotCount = 0;
+   if(!hashes.empty())
+   {
+      slotCount = 1;
+      while(slotCount < 2 * hashes.size())
+      {
+         slotCount *= 2;
+      }
+   }
+   std::vector<unsigned int> slots(slotCount ? slotCount : 1, 0);
+   for(size_t i = 0; i < hashes.size(); i++)
+   {
+      size_t slot = hashes[i] & (slotCount - 1);
+      while(slots[slot] != 0)
+      {
+         slot = (slot + 1) & (slotCount - 1);
+      }
+      slots[slot] = static_cast<unsigned int>(i + 1);
+   }
+
+   out << "constexpr unsigned int slots[] =\n{";
+   for(size_t i = 0; i < slots.size(); i++)
+   {
+      out << (i % 16 == 0 ? "\n   " : " ") << slots[i] << (i + 1 < slots.size() ? "," : "");
+   }
+   out << "\n};\n\n";
+   out << "}\n\n";
+
+   out << "extern const SimpleConfig::EmbeddedTable " << symbol << ";\n";
+   out << "const SimpleConfig::EmbeddedTable " << symbol << " = {entries, " << hashes.size()
+       << ", slots, " << slotCount << "};\n";
+}
+
+}
@@ -0,0 +1,20 @@
+#ifndef CONFIG_EMBEDDER_H
+#define CONFIG_EMBEDDER_H
+
+#include <string>
+#include <ostream>
+
+namespace SimpleConfig
+{
+
+class ConfigParser;
+
+//Writes C++ source defining `const SimpleConfig::EmbeddedTable symbol`
+//with every visible value of config, for use with EmbeddedConfig. The
+//entries are sorted, converted and hashed here, so the program that
+//embeds them parses nothing.
+void WriteEmbeddedConfig(const ConfigParser& config, const std::string& symbol, std::ostream& out);
+
+}
+
+#endif /* CONFIG_EMBEDDER_H */
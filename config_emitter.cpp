@@ -0,0 +1,98 @@
+#include "config_emitter.h"
+#include "config_parser.h"
+#include "parse_utilities.h"
+
+namespace SimpleConfig
+{
+
+static const char assignText[] = " = ";
+static const size_t assignLength = sizeof(assignText) - 1;
+
+//Both passes read the value bytes straight from the store
+static size_t CanonicalLength(const ConfigParser::SectionIndex& sections, const ValueStore& values)
+{
+   char scratch[NUMBER_TEXT_SIZE];
+   size_t length = 0;
+   for(ConfigParser::SectionIndex::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      if(!sectionIt->first.empty())
+      {
+         length += sectionIt->first.size() + 4; //"\n[" name "]\n"
+      }
+      for(ConfigParser::KeyIndex::const_iterator keyIt = sectionIt->second.begin(); keyIt != sectionIt->second.end(); ++keyIt)
+      {
+         size_t valueLength;
+         const char* value = values.TextData(keyIt->second, scratch, valueLength);
+         length += keyIt->first.size() + assignLength + TokenSourceLength(values.Type(keyIt->second), value, valueLength) + 1;
+      }
+   }
+   return length;
+}
+
+static void AppendCanonical(std::string& out, const ConfigParser::SectionIndex& sections, const ValueStore& values)
+{
+   char scratch[NUMBER_TEXT_SIZE];
+   //The unnamed section sorts first, so its keys precede every header
+   for(ConfigParser::SectionIndex::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      if(!sectionIt->first.empty())
+      {
+         if(!out.empty())
+         {
+            out += '\n';
+         }
+         out += '[';
+         out += sectionIt->first;
+         out += "]\n";
+      }
+      for(ConfigParser::KeyIndex::const_iterator keyIt = sectionIt->second.begin(); keyIt != sectionIt->second.end(); ++keyIt)
+      {
+         out += keyIt->first;
+         out.append(assignText, assignLength);
+         size_t valueLength;
+         const char* value = values.TextData(keyIt->second, scratch, valueLength);
+         AppendTokenSourceText(out, values.Type(keyIt->second), value, valueLength);
+         out += '\n';
+      }
+   }
+}
+
+void EmitConfig(const ConfigParser& config, std::string& out)
+{
+   out.clear();
+   if(config.mKeepLayout)
+   {
+      size_t length = 0;
+      for(size_t i = 0; i < config.mLayout.size(); i++)
+      {
+         length += config.mLayout[i].trivia.size() + config.mLayout[i].text.size();
+      }
+      out.reserve(length);
+      for(size_t i = 0; i < config.mLayout.size(); i++)
+      {
+         out += config.mLayout[i].trivia;
+         out += config.mLayout[i].text;
+      }
+   }
+   else
+   {
+      out.reserve(CanonicalLength(config.parseMap, config.mValues));
+      AppendCanonical(out, config.parseMap, config.mValues);
+   }
+}
+
+std::string EmitConfig(const ConfigParser& config)
+{
+   std::string out;
+   EmitConfig(config, out);
+   return out;
+}
+
+void EmitConfig(const ConfigParser& config, std::ostream& out)
+{
+   std::string buffer;
+   EmitConfig(config, buffer);
+   out.write(buffer.data(), buffer.size());
+}
+
+}
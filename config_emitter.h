@@ -0,0 +1,23 @@
+#ifndef CONFIG_EMITTER_H
+#define CONFIG_EMITTER_H
+
+#include <string>
+#include <ostream>
+
+namespace SimpleConfig
+{
+
+class ConfigParser;
+
+//Writes a parsed config back out as text. If it was parsed with
+//KeepLayout(true) the recorded source is reproduced byte for byte,
+//otherwise a canonical form is written: unsectioned keys first, then
+//each section, with keys in sorted order.
+//The output is sized up front and built in a single buffer.
+void EmitConfig(const ConfigParser& config, std::string& out);
+std::string EmitConfig(const ConfigParser& config);
+void EmitConfig(const ConfigParser& config, std::ostream& out);
+
+}
+
+#endif /* CONFIG_EMITTER_H */
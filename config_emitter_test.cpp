@@ -0,0 +1,63 @@
+#include "config_emitter.h"
+#include "config_parser.h"
+#include "config_diff.h"
+#include "gtest/gtest.h"
+#include <sstream>
+
+namespace
+{
+
+const std::string testConfig =
+   "# leading comment\n"
+   "testInt=1\n"
+   "\n"
+   "  testDouble =  2.5   # trailing comment\r\n"
+   "testWhole = 2.0\n"
+   "testHex = 0x10\n"
+   "testString=\"Hello\n World\"\n"
+   "testEscaped=\"say \\\"hi\\\"\\t\\u00e9 C:\\\\\"\n"
+   "[Section1]\n"
+   "testList = [ 1,2 , \"x\" ]\n"
+   "testBool=TRUE\n"
+   "\n"
+   "#final comment without newline";
+
+TEST(EmitTest, KeptLayoutRoundTripsExactly)
+{
+   std::istringstream configStream(testConfig);
+   SimpleConfig::ConfigParser c;
+   c.KeepLayout(true);
+   c.Parse(configStream);
+   EXPECT_EQ(testConfig, SimpleConfig::EmitConfig(c));
+}
+
+TEST(EmitTest, CanonicalOutputParsesToSameConfig)
+{
+   std::istringstream configStream(testConfig);
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+
+   std::string emitted = SimpleConfig::EmitConfig(c);
+   std::istringstream emittedStream(emitted);
+   SimpleConfig::ConfigParser reparsed;
+   reparsed.Parse(emittedStream);
+
+   std::vector<SimpleConfig::ConfigChange> changes = SimpleConfig::DiffConfigs(c, reparsed);
+   for(size_t i = 0; i < changes.size(); i++)
+   {
+      //Only source lines may differ
+      EXPECT_EQ(SimpleConfig::KEY_CHANGED, changes[i].type);
+      EXPECT_EQ(changes[i].oldValue.type, changes[i].newValue.type) << changes[i].key;
+      EXPECT_EQ(changes[i].oldValue.lexeme, changes[i].newValue.lexeme) << changes[i].key;
+   }
+}
+
+TEST(EmitTest, CanonicalFormat)
+{
+   std::istringstream configStream("b=2\n[S]\nx=\"y\"\n a = 1");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   EXPECT_EQ("b = 2\n\n[S]\na = 1\nx = \"y\"\n", SimpleConfig::EmitConfig(c));
+}
+
+}
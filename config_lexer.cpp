@@ -1,9 +1,14 @@
 #include "config_lexer.h"
 #include <sstream>
 #include <cstdio>
+#include <cctype>
 #include <cstring>
 #include <stdexcept>
 #include "parse_utilities.h"
+#include "memory_stream.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace SimpleConfig
 {
@@ -24,7 +29,122 @@ const std::set<char> ConfigLexer::hexDigits(_hex, _hex+strlen(_hex));
 const char *_letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
 const std::set<char> ConfigLexer::letters(_letters, _letters+strlen(_letters));
 
-ConfigLexer::ConfigLexer(): line(1)
+std::string TokenSourceText(const Token& tok)
+{
+   std::string text;
+   AppendTokenSourceText(text, tok);
+   return text;
+}
+
+void AppendTokenSourceText(std::string& text, const Token& tok)
+{
+   AppendTokenSourceText(text, tok.type, tok.lexeme.data(), tok.lexeme.size());
+}
+
+size_t TokenSourceLength(TokenType type, const char* data, size_t length)
+{
+   if(type != STRING)
+   {
+      return length;
+   }
+   size_t sourceLength = length + 2;
+   for(size_t i = 0; i < length; i++)
+   {
+      if(data[i] == '"' || data[i] == '\\')
+      {
+         sourceLength++;
+      }
+   }
+   return sourceLength;
+}
+
+void AppendTokenSourceText(std::string& text, TokenType type, const char* data, size_t length)
+{
+   if(type != STRING)
+   {
+      text.append(data, length);
+      return;
+   }
+   text += '"';
+   for(size_t i = 0; i < length; i++)
+   {
+      if(data[i] == '"' || data[i] == '\\')
+      {
+         text += '\\';
+      }
+      text += data[i];
+   }
+   text += '"';
+}
+
+//First byte in [begin, end) that ends a string, starts an escape, ends
+//a line or is not ASCII. Everything before it is copied as is.
+static const char* SkipPlainAscii(const char* begin, const char* end)
+{
+   const char* p = begin;
+#ifdef __SSE2__
+   const __m128i quote = _mm_set1_epi8('"');
+   const __m128i backslash = _mm_set1_epi8('\\');
+   const __m128i newline = _mm_set1_epi8('\n');
+   while(end - p >= 16)
+   {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)),
+         _mm_cmpeq_epi8(bytes, newline));
+      //Non-ASCII bytes already have their top bit set
+      int mask = _mm_movemask_epi8(_mm_or_si128(special, bytes));
+      if(mask)
+      {
+         return p + __builtin_ctz(mask);
+      }
+      p += 16;
+   }
+#endif
+   while(p < end && *p != '"' && *p != '\\' && *p != '\n' && static_cast<unsigned char>(*p) < 0x80)
+   {
+      p++;
+   }
+   return p;
+}
+
+static void AppendUtf8(std::string& text, unsigned int codePoint)
+{
+   if(codePoint < 0x80)
+   {
+      text += static_cast<char>(codePoint);
+   }
+   else if(codePoint < 0x800)
+   {
+      text += static_cast<char>(0xC0 | (codePoint >> 6));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+   }
+   else if(codePoint < 0x10000)
+   {
+      text += static_cast<char>(0xE0 | (codePoint >> 12));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+   }
+   else
+   {
+      text += static_cast<char>(0xF0 | (codePoint >> 18));
+      text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+   }
+}
+
+static std::string ByteText(int c)
+{
+   if(c == EOF)
+   {
+      return "end of input";
+   }
+   char text[16];
+   std::snprintf(text, sizeof(text), "byte 0x%02X", static_cast<unsigned int>(c) & 0xFF);
+   return text;
+}
+
+ConfigLexer::ConfigLexer(): line(1), recordTrivia(false)
 {}
 
 
@@ -45,38 +165,99 @@ const std::vector<Token> ConfigLexer::Scan(std::istream& source)
    return tokens;
 }
 
+int ConfigLexer::GetLine() const
+{
+   return line;
+}
+
+void ConfigLexer::SetLine(int newLine)
+{
+   line = newLine;
+}
+
+void ConfigLexer::RecordTrivia(bool record)
+{
+   recordTrivia = record;
+   trivia.clear();
+}
+
+const std::string& ConfigLexer::GetTrivia() const
+{
+   return trivia;
+}
+
+const std::string& ConfigLexer::GetStringSource() const
+{
+   return stringSource;
+}
+
 Token ConfigLexer::GetNextToken(std::istream& source)
 {
+   Token t;
+   GetNextToken(source, t);
+   return t;
+}
+
+static void SetToken(Token& tok, TokenType type, const char* lexeme, int line)
+{
+   tok.type = type;
+   tok.lexeme.assign(lexeme);
+   tok.lineNum = line;
+}
+
+//The lexeme is built in place, so a token reused across calls only
+//allocates when a lexeme outgrows every earlier one
+void ConfigLexer::GetNextToken(std::istream& source, Token& tok)
+{
+   if(recordTrivia)
+   {
+      trivia.clear();
+   }
+
    while(true)
    {
       int c = source.get();
 
       if(whitespace.count(c))
       {
+         if(recordTrivia)
+         {
+            trivia += c;
+         }
          continue;
       }
       else if (c == '[')
       {
-         Token t = {LEFT_BRACKET, "[", line};
-         return t;
+         SetToken(tok, LEFT_BRACKET, "[", line);
+         return;
       }
       else if (c == ']')
       {
-         Token t = {RIGHT_BRACKET, "]", line};
-         return t;
+         SetToken(tok, RIGHT_BRACKET, "]", line);
+         return;
       }
       else if (c == '=')
       {
-         Token t = {EQUALS, "=", line};
-         return t;
+         SetToken(tok, EQUALS, "=", line);
+         return;
+      }
+      else if (c == ',')
+      {
+         SetToken(tok, COMMA, ",", line);
+         return;
       }
       else if (c == '\n')
       {
+         if(recordTrivia)
+         {
+            trivia += c;
+         }
          line++;
       }
       else if (c == '"')
       {
-         return LexString(source);
+         LexString(source, tok);
+         return;
       }
       else if (c == '#')
       {
@@ -85,158 +266,383 @@ Token ConfigLexer::GetNextToken(std::istream& source)
       else if (digits.count(c) || c == '-')
       {
          source.unget();
-         return LexNumber(source);
+         LexNumber(source, tok);
+         return;
       }
       else if (letters.count(c) || c == '_')
       {
          source.unget();
-         return LexBoolOrIdentifier(source);
+         LexBoolOrIdentifier(source, tok);
+         return;
       }
       else if (c == EOF)
       {
-         Token t = {END_OF_FILE, "", line};
-         return t;
+         SetToken(tok, END_OF_FILE, "", line);
+         return;
       }
       else
       {
-         UnexpectedCharacterError(c);
+         UnexpectedCharacterError(source, c);
       }
    }
 }
 
-Token ConfigLexer::LexString(std::istream& source)
+//Plain ASCII runs are copied straight out of the stream buffer; only
+//escapes and multibyte characters are handled a byte at a time
+void ConfigLexer::LexString(std::istream& source, Token& t)
 {
-   int startLine = line;
-   std::stringstream buf;
+   t.type = STRING;
+   t.lexeme.clear();
+   t.lineNum = line;
+   if(recordTrivia)
+   {
+      stringSource = "\"";
+   }
+   std::streambuf* buf = source.rdbuf();
    while(true)
    {
-      char c = source.get();
-      Token t = {STRING, buf.str(), startLine};
+      const char* begin = BufferedBytes::Begin(buf);
+      const char* plain = SkipPlainAscii(begin, BufferedBytes::End(buf));
+      if(plain != begin)
+      {
+         t.lexeme.append(begin, plain);
+         if(recordTrivia)
+         {
+            stringSource.append(begin, plain);
+         }
+         BufferedBytes::Consume(buf, plain - begin);
+      }
+
+      int c = NextStringByte(source);
       switch(c)
       {
       case EOF:
-         UnterminatedStringError(startLine);
+         UnterminatedStringError(t.lineNum);
          break;
       case '"':
-         return t;
+         return;
+      case '\\':
+         LexEscape(source, t.lexeme);
+         break;
       case '\n':
          line++;
+         t.lexeme += '\n';
+         break;
       default:
-         buf.put(c);
+         if(c >= 0x80)
+         {
+            LexMultibyte(source, c, t.lexeme);
+         }
+         else
+         {
+            t.lexeme += static_cast<char>(c);
+         }
          break;
       }
    }
 }
 
+//Escapes: \" \\ \n \t \r and \uXXXX (UTF-16, so characters beyond
+//U+FFFF are written as a surrogate pair)
+void ConfigLexer::LexEscape(std::istream& source, std::string& text)
+{
+   int c = NextStringByte(source);
+   switch(c)
+   {
+   case '"':
+   case '\\':
+      text += static_cast<char>(c);
+      return;
+   case 'n':
+      text += '\n';
+      return;
+   case 't':
+      text += '\t';
+      return;
+   case 'r':
+      text += '\r';
+      return;
+   case 'u':
+      break;
+   case EOF:
+      InvalidStringError(source, "escape sequence", "end of input");
+      break;
+   default:
+      InvalidStringError(source, "escape sequence", std::string("\\") + static_cast<char>(c));
+      break;
+   }
+
+   unsigned int codePoint = LexHexQuad(source);
+   if(codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+   {
+      InvalidStringError(source, "surrogate pair", "unpaired surrogate");
+   }
+   if(codePoint >= 0xD800 && codePoint <= 0xDBFF)
+   {
+      if(NextStringByte(source) != '\\' || NextStringByte(source) != 'u')
+      {
+         InvalidStringError(source, "surrogate pair", "unpaired surrogate");
+      }
+      unsigned int low = LexHexQuad(source);
+      if(low < 0xDC00 || low > 0xDFFF)
+      {
+         InvalidStringError(source, "surrogate pair", "unpaired surrogate");
+      }
+      codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+   }
+   AppendUtf8(text, codePoint);
+}
+
+unsigned int ConfigLexer::LexHexQuad(std::istream& source)
+{
+   unsigned int value = 0;
+   for(int i = 0; i < 4; i++)
+   {
+      int c = NextStringByte(source);
+      unsigned int digit;
+      if(c >= '0' && c <= '9')
+      {
+         digit = c - '0';
+      }
+      else if(c >= 'a' && c <= 'f')
+      {
+         digit = c - 'a' + 10;
+      }
+      else if(c >= 'A' && c <= 'F')
+      {
+         digit = c - 'A' + 10;
+      }
+      else
+      {
+         InvalidStringError(source, "four hex digits after \\u", (c == EOF) ? std::string("end of input") : std::string(1, static_cast<char>(c)));
+         return 0;
+      }
+      value = (value << 4) | digit;
+   }
+   return value;
+}
+
+//Copies one UTF-8 encoded character starting with lead, rejecting
+//overlong forms, surrogates and code points beyond U+10FFFF
+void ConfigLexer::LexMultibyte(std::istream& source, int lead, std::string& text)
+{
+   int continuations;
+   int low = 0x80;
+   int high = 0xBF;
+   if(lead >= 0xC2 && lead <= 0xDF)
+   {
+      continuations = 1;
+   }
+   else if(lead >= 0xE0 && lead <= 0xEF)
+   {
+      continuations = 2;
+      low = (lead == 0xE0) ? 0xA0 : 0x80;
+      high = (lead == 0xED) ? 0x9F : 0xBF;
+   }
+   else if(lead >= 0xF0 && lead <= 0xF4)
+   {
+      continuations = 3;
+      low = (lead == 0xF0) ? 0x90 : 0x80;
+      high = (lead == 0xF4) ? 0x8F : 0xBF;
+   }
+   else
+   {
+      InvalidStringError(source, "UTF-8 text", ByteText(lead));
+      return;
+   }
+
+   text += static_cast<char>(lead);
+   for(int i = 0; i < continuations; i++)
+   {
+      int c = NextStringByte(source);
+      if(c < low || c > high)
+      {
+         InvalidStringError(source, "UTF-8 text", ByteText(c));
+      }
+      text += static_cast<char>(c);
+      low = 0x80;
+      high = 0xBF;
+   }
+}
+
+int ConfigLexer::NextStringByte(std::istream& source)
+{
+   int c = source.get();
+   if(recordTrivia && c != EOF)
+   {
+      stringSource += static_cast<char>(c);
+   }
+   return c;
+}
+
 void ConfigLexer::LexComment(std::istream& source)
 {
+   if(recordTrivia)
+   {
+      trivia += '#';
+   }
    int c = source.get();
    while(c != '\n' && c != EOF)
    {
+      if(recordTrivia)
+      {
+         trivia += c;
+      }
       c = source.get();
    }
    source.unget();
 }
 
-Token ConfigLexer::LexBoolOrIdentifier(std::istream& source)
+//Compares word with an upper case keyword, ignoring case
+static bool IsKeyword(const std::string& word, const char* keyword)
+{
+   size_t i = 0;
+   for(; i < word.size() && keyword[i] != '\0'; i++)
+   {
+      if(std::toupper(static_cast<unsigned char>(word[i])) != keyword[i])
+      {
+         return false;
+      }
+   }
+   return i == word.size() && keyword[i] == '\0';
+}
+
+void ConfigLexer::LexBoolOrIdentifier(std::istream& source, Token& tok)
 {
-   std::stringstream lexeme;
+   tok.lexeme.clear();
+   tok.lineNum = line;
    char c = source.get();
-   while(letters.count(c) || digits.count(c) || c == '_')
+   //Dots join the parts of hierarchical section names
+   while(letters.count(c) || digits.count(c) || c == '_' || c == '.')
    {
-      lexeme << c;
+      tok.lexeme += c;
       c = source.get();
    }
    source.unget();
 
-   std::string upperCasedWord = ToUppered(lexeme.str());
-   if(upperCasedWord == "TRUE" || upperCasedWord == "FALSE")
-   {
-      Token t = {BOOL, lexeme.str(), line};
-      return t;
-   }
-   Token t = {IDENTIFIER, lexeme.str(), line};
-   return t;
+   tok.type = (IsKeyword(tok.lexeme, "TRUE") || IsKeyword(tok.lexeme, "FALSE")) ? BOOL : IDENTIFIER;
 }
 
-Token ConfigLexer::LexNumber(std::istream& source)
+void ConfigLexer::LexNumber(std::istream& source, Token& tok)
 {
-   std::stringstream lexeme;
+   std::string& lexeme = tok.lexeme;
+   lexeme.clear();
+   tok.lineNum = line;
    bool real=false;
    char c = source.get();
-   std::set<char> baseDigits;
-   baseDigits = digits;
+   const std::set<char>* baseDigits = &digits;
 
    if(c == '-')
    {
-      lexeme << c;
+      lexeme += c;
       c = source.get();
    }
    if(c == '0')
    {
-      lexeme << c;
+      lexeme += c;
       c = source.get();
-      baseDigits = octalDigits;
+      baseDigits = &octalDigits;
       if(c == 'x')
       {
-         lexeme << c;
+         lexeme += c;
          c = source.get();
-         baseDigits = hexDigits;
+         baseDigits = &hexDigits;
       }
    }
-   while(baseDigits.count(c))
+   while(baseDigits->count(c))
    {
-      lexeme << c;
+      lexeme += c;
       c = source.get();
    }
    if(c == '.')
    {
       real=true;
-      lexeme << c;
+      lexeme += c;
       c = source.get();
+      //A leading 0 makes integers octal, but fractions are always decimal
+      if(baseDigits == &octalDigits)
+      {
+         baseDigits = &digits;
+      }
    }
-   while(baseDigits.count(c))
+   while(baseDigits->count(c))
    {
-      lexeme << c;
+      lexeme += c;
       c = source.get();
    }
    if(c == 'e' || c == 'E')
    {
       real=true;
-      lexeme << c;
+      lexeme += c;
       c = source.get();
    }
-   while(baseDigits.count(c))
+   while(baseDigits->count(c))
    {
-      lexeme << c;
+      lexeme += c;
       c = source.get();
    }
    source.unget();
 
-   if(real)
-   {
-      Token t = {REAL_NUMBER, lexeme.str(), line};
-      return t;
-   }
-   Token t = {INTEGER, lexeme.str(), line};
-   return t;
+   tok.type = real ? REAL_NUMBER : INTEGER;
 }
 
-void ConfigLexer::UnexpectedCharacterError(char c)
+//Byte column of the character just read, when the whole input is in memory
+static int ReadColumn(std::istream& source)
+{
+   const MemoryStreamBuf* memory = dynamic_cast<const MemoryStreamBuf*>(source.rdbuf());
+   return memory ? memory->Column(1) : 0;
+}
+
+void ConfigLexer::UnexpectedCharacterError(std::istream& source, char c)
 {
    std::ostringstream messageBuf;
    messageBuf << "Unexpected character '" << c << "' (line " << line <<")";
-   throw std::logic_error(messageBuf.str());
+   Diagnostic diagnostic = {line, ReadColumn(source), "token", std::string(1, c)};
+   throw LexError(messageBuf.str(), diagnostic);
 }
 
 void ConfigLexer::UnterminatedStringError(int startLine)
 {
    std::ostringstream messageBuf;
    messageBuf<< "Unterminiated string (line "<< startLine << ")";
-   throw std::logic_error(messageBuf.str());
+   Diagnostic diagnostic = {startLine, 0, "'\"' closing the string", "end of input"};
+   throw LexError(messageBuf.str(), diagnostic);
 }
 
+void ConfigLexer::InvalidStringError(std::istream& source, const char* expected, const std::string& got)
+{
+   std::ostringstream messageBuf;
+   messageBuf << "Invalid string (line " << line << ")\n";
+   messageBuf << "Expected: " << expected << " Got: " << got;
+   Diagnostic diagnostic = {line, ReadColumn(source), expected, got};
+   throw LexError(messageBuf.str(), diagnostic);
+}
 
+//Error recovery resumes lexing on the next line
+void ConfigLexer::SkipLine(std::istream& source)
+{
+   int c = source.get();
+   while(c != '\n' && c != EOF)
+   {
+      c = source.get();
+   }
+   if(c == '\n')
+   {
+      line++;
+   }
+}
+
+
+LexError::LexError(const std::string& message, const Diagnostic& diagnostic):
+   std::logic_error(message), mDiagnostic(diagnostic)
+{}
+
+LexError::~LexError() throw()
+{}
 
+const Diagnostic& LexError::GetDiagnostic() const
+{
+   return mDiagnostic;
+}
 
 }
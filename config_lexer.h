@@ -5,14 +5,16 @@
 #include <istream>
 #include <vector>
 #include <set>
+#include <stdexcept>
 
 namespace SimpleConfig
 {
 
 typedef enum tokenType
 {
-   LEFT_BRACKET, RIGHT_BRACKET, EQUALS,
+   LEFT_BRACKET, RIGHT_BRACKET, EQUALS, COMMA,
    IDENTIFIER, INTEGER, REAL_NUMBER, STRING, BOOL,
+   LIST, //Only produced by the parser for list values
    END_OF_FILE
 } TokenType;
 
@@ -23,6 +25,40 @@ typedef struct token
    int lineNum;
 } Token;
 
+//Where and why input could not be lexed or parsed. column counts bytes
+//from 1 and is 0 when not known.
+typedef struct diagnostic
+{
+   int line;
+   int column;
+   std::string expected;
+   std::string got;
+} Diagnostic;
+
+//Thrown for input that does not lex. The diagnostic holds the parts of
+//the message.
+class LexError : public std::logic_error
+{
+public:
+   LexError(const std::string& message, const Diagnostic& diagnostic);
+   virtual ~LexError() throw();
+
+   const Diagnostic& GetDiagnostic() const;
+
+private:
+   Diagnostic mDiagnostic;
+};
+
+//Text that lexes back to tok (strings get their quotes back, and '"'
+//and '\\' their escapes)
+std::string TokenSourceText(const Token& tok);
+void AppendTokenSourceText(std::string& text, const Token& tok);
+
+//The same for a value of the given type whose lexeme is the length
+//bytes at data
+size_t TokenSourceLength(TokenType type, const char* data, size_t length);
+void AppendTokenSourceText(std::string& text, TokenType type, const char* data, size_t length);
+
 
 class ConfigLexer
 {
@@ -32,16 +68,41 @@ public:
 
    const std::vector<Token> Scan(std::istream& source);
    Token GetNextToken(std::istream& source);
+   //Overwrites tok, reusing the capacity of its lexeme
+   void GetNextToken(std::istream& source, Token& tok);
+
+   int GetLine() const;
+   void SetLine(int newLine);
+
+   //Discards the rest of the current line, newline included
+   void SkipLine(std::istream& source);
+
+   //When recording, the whitespace and comments skipped before each
+   //token are kept and can be read back after GetNextToken returns.
+   void RecordTrivia(bool record);
+   const std::string& GetTrivia() const;
+
+   //When recording, the last string token as written, quotes and
+   //escapes included
+   const std::string& GetStringSource() const;
 
 private:
-   Token LexBoolOrIdentifier(std::istream& source);
-   Token LexNumber(std::istream& source);
-   Token LexString(std::istream& source);
+   void LexBoolOrIdentifier(std::istream& source, Token& tok);
+   void LexNumber(std::istream& source, Token& tok);
+   void LexString(std::istream& source, Token& tok);
+   void LexEscape(std::istream& source, std::string& text);
+   unsigned int LexHexQuad(std::istream& source);
+   void LexMultibyte(std::istream& source, int lead, std::string& text);
+   int NextStringByte(std::istream& source);
    void LexComment(std::istream& source);
-   void UnexpectedCharacterError(char c);
+   void UnexpectedCharacterError(std::istream& source, char c);
    void UnterminatedStringError(int startLine);
+   void InvalidStringError(std::istream& source, const char* expected, const std::string& got);
 
    int line;
+   bool recordTrivia;
+   std::string trivia;
+   std::string stringSource;
 
    static const std::set<char> whitespace;
    static const std::set<char> digits;
@@ -52,5 +113,15 @@ private:
 
 };
 
+
+//Supplies tokens to the parser one at a time. Next overwrites tok so
+//that its lexeme's capacity is reused from token to token.
+class TokenSource
+{
+public:
+   virtual ~TokenSource() {}
+   virtual void Next(Token& tok) = 0;
+};
+
 }
 #endif /*CONFIG_LEXER_H*/
@@ -1,4 +1,5 @@
 #include "config_lexer.h"
+#include "memory_stream.h"
 #include "gtest/gtest.h"
 #include <sstream>
 #include <stdexcept>
@@ -41,6 +42,16 @@ TEST(ScanTest, EqualsLexed)
    EXPECT_EQ(testTokens.front().type, SimpleConfig::EQUALS);
 }
 
+TEST(ScanTest, CommaLexed)
+{
+   SimpleConfig::ConfigLexer l;
+   std::istringstream testSource("1,2");
+   const std::vector<SimpleConfig::Token> testTokens = l.Scan(testSource);
+   EXPECT_EQ(testTokens[0].type, SimpleConfig::INTEGER);
+   EXPECT_EQ(testTokens[1].type, SimpleConfig::COMMA);
+   EXPECT_EQ(testTokens[2].type, SimpleConfig::INTEGER);
+}
+
 TEST(ScanTest, WhitespaceSkipped)
 {
    SimpleConfig::ConfigLexer l;
@@ -113,6 +124,18 @@ TEST(ScanTest, RealNumberLexingWorks)
    EXPECT_EQ(testTokens[0].lineNum, 1);
 }
 
+TEST(ScanTest, FractionAfterLeadingZeroIsDecimal)
+{
+   SimpleConfig::ConfigLexer l;
+   std::istringstream testSource(" 0.663993 0.9 ");
+   const std::vector<SimpleConfig::Token> testTokens = l.Scan(testSource);
+   EXPECT_EQ(testTokens[0].type, SimpleConfig::REAL_NUMBER);
+   EXPECT_EQ(testTokens[0].lexeme, "0.663993");
+   EXPECT_EQ(testTokens[1].type, SimpleConfig::REAL_NUMBER);
+   EXPECT_EQ(testTokens[1].lexeme, "0.9");
+   EXPECT_EQ(testTokens[2].type, SimpleConfig::END_OF_FILE);
+}
+
 TEST(ScanTest, BadNumberFormatThrows)
 {
    SimpleConfig::ConfigLexer l;
@@ -130,6 +153,15 @@ TEST(ScanTest, IdLexingWorks)
    EXPECT_EQ(testTokens[0].lineNum, 1);
 }
 
+TEST(ScanTest, DottedIdLexingWorks)
+{
+   SimpleConfig::ConfigLexer l;
+   std::istringstream testSource(" prod.us_east.web ");
+   const std::vector<SimpleConfig::Token> testTokens = l.Scan(testSource);
+   EXPECT_EQ(testTokens[0].type, SimpleConfig::IDENTIFIER);
+   EXPECT_EQ(testTokens[0].lexeme, "prod.us_east.web");
+}
+
 TEST(ScanTest, UnterminatedStringThrows)
 {
    SimpleConfig::ConfigLexer l;
@@ -137,6 +169,121 @@ TEST(ScanTest, UnterminatedStringThrows)
    EXPECT_THROW(l.Scan(testSource), std::logic_error);
 }
 
+TEST(ScanTest, StringEscapesDecoded)
+{
+   SimpleConfig::ConfigLexer l;
+   std::istringstream testSource("\"say \\\"hi\\\"\\n\\tC:\\\\dir\\r \\u00e9\\u20AC \\ud83d\\ude00\"");
+   const std::vector<SimpleConfig::Token> testTokens = l.Scan(testSource);
+   EXPECT_EQ(testTokens.front().lexeme, "say \"hi\"\n\tC:\\dir\r \xC3\xA9\xE2\x82\xAC \xF0\x9F\x98\x80");
+}
+
+TEST(ScanTest, BadEscapesThrow)
+{
+   const char* sources[] = {"\"\\q\"", "\"\\u12G4\"", "\"\\udc00\"", "\"\\ud83d x\"", "\"\\ud83d\\u0041\"", "\"\\"};
+   for(size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++)
+   {
+      SimpleConfig::ConfigLexer l;
+      std::istringstream testSource(sources[i]);
+      EXPECT_THROW(l.Scan(testSource), std::logic_error) << sources[i];
+   }
+}
+
+TEST(ScanTest, LexErrorsCarryDiagnostics)
+{
+   std::string text = "a = 1\n  b = \"\xC3x\"\nnext";
+   SimpleConfig::MemoryStreamBuf buf(text.data(), text.size());
+   std::istream testSource(&buf);
+   SimpleConfig::ConfigLexer l;
+   SimpleConfig::Token tok;
+   for(int i = 0; i < 5; i++)
+   {
+      l.GetNextToken(testSource, tok);
+   }
+   try
+   {
+      l.GetNextToken(testSource, tok);
+      FAIL() << "no exception";
+   }
+   catch(SimpleConfig::LexError& e)
+   {
+      const SimpleConfig::Diagnostic& d = e.GetDiagnostic();
+      EXPECT_EQ(2, d.line);
+      EXPECT_EQ(9, d.column); //Counted in bytes, at the bad continuation byte
+      EXPECT_EQ("UTF-8 text", d.expected);
+      EXPECT_EQ("byte 0x78", d.got);
+   }
+
+   l.SkipLine(testSource);
+   l.GetNextToken(testSource, tok);
+   EXPECT_EQ("next", tok.lexeme);
+   EXPECT_EQ(3, tok.lineNum);
+}
+
+TEST(ScanTest, Utf8StringsValidated)
+{
+   SimpleConfig::ConfigLexer l;
+   std::istringstream valid("\"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF\"");
+   EXPECT_EQ(l.Scan(valid).front().lexeme, "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF");
+
+   //Stray continuation, overlong, surrogate, beyond U+10FFFF, truncated, 0xFF
+   const char* invalid[] = {"\"\x80\"", "\"\xC0\xAF\"", "\"\xE0\x80\xAF\"", "\"\xED\xA0\x80\"",
+      "\"\xF4\x90\x80\x80\"", "\"\xE2\x82\"", "\"\xFF\""};
+   for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+   {
+      SimpleConfig::ConfigLexer lexer;
+      std::istringstream testSource(invalid[i]);
+      EXPECT_THROW(lexer.Scan(testSource), std::logic_error) << i;
+   }
+}
+
+//Strings long enough for the bulk copy, with specials at every offset
+TEST(ScanTest, LongStringsMatchBytewiseLexing)
+{
+   for(size_t offset = 0; offset < 40; offset++)
+   {
+      std::string plain(40, 'a');
+      std::string source = "\"" + plain.substr(0, offset) + "\\\\\xC3\xA9\n" + plain + "\" next";
+      SimpleConfig::ConfigLexer l;
+      std::istringstream testSource(source);
+      const std::vector<SimpleConfig::Token> testTokens = l.Scan(testSource);
+      EXPECT_EQ(testTokens[0].lexeme, plain.substr(0, offset) + "\\\xC3\xA9\n" + plain);
+      EXPECT_EQ(testTokens[1].lexeme, "next");
+      EXPECT_EQ(testTokens[1].lineNum, 2);
+   }
+}
+
+TEST(ScanTest, SourceTextEscapesStrings)
+{
+   SimpleConfig::Token tok = {SimpleConfig::STRING, "a\"b\\c\n", 1};
+   std::string text = SimpleConfig::TokenSourceText(tok);
+   EXPECT_EQ(text, "\"a\\\"b\\\\c\n\"");
+
+   SimpleConfig::ConfigLexer l;
+   std::istringstream testSource(text);
+   EXPECT_EQ(l.Scan(testSource).front().lexeme, tok.lexeme);
+}
+
+//Each token overwrites the last, whatever it held before
+TEST(ScanTest, ReusedTokenIsOverwritten)
+{
+   SimpleConfig::ConfigLexer l;
+   std::istringstream testSource("\"a fairly long string value\" 12 TrUe x");
+   SimpleConfig::Token tok;
+   l.GetNextToken(testSource, tok);
+   EXPECT_EQ(tok.lexeme, "a fairly long string value");
+   l.GetNextToken(testSource, tok);
+   EXPECT_EQ(tok.type, SimpleConfig::INTEGER);
+   EXPECT_EQ(tok.lexeme, "12");
+   l.GetNextToken(testSource, tok);
+   EXPECT_EQ(tok.type, SimpleConfig::BOOL);
+   l.GetNextToken(testSource, tok);
+   EXPECT_EQ(tok.type, SimpleConfig::IDENTIFIER);
+   EXPECT_EQ(tok.lexeme, "x");
+   l.GetNextToken(testSource, tok);
+   EXPECT_EQ(tok.type, SimpleConfig::END_OF_FILE);
+   EXPECT_EQ(tok.lexeme, "");
+}
+
 TEST(ScanTest, UnexpecetedCharThrows)
 {
    SimpleConfig::ConfigLexer l;
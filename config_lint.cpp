@@ -0,0 +1,215 @@
+#include "config_lint.h"
+#include "config_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace SimpleConfig
+{
+
+static bool HasSuffix(const std::string& name, const std::vector<std::string>& suffixes)
+{
+   if(suffixes.empty())
+   {
+      return true;
+   }
+   for(size_t i = 0; i < suffixes.size(); i++)
+   {
+      const std::string& suffix = suffixes[i];
+      if(name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+//Directories already walked, by device and inode, so that symbolic
+//links to a directory above do not make the walk loop
+typedef std::set<std::pair<dev_t, ino_t> > VisitedDirectories;
+
+static void CollectDirectory(const std::string& dir, const struct stat& dirInfo, const std::vector<std::string>& suffixes,
+   std::vector<std::string>& files, VisitedDirectories& visited)
+{
+   if(!visited.insert(std::make_pair(dirInfo.st_dev, dirInfo.st_ino)).second)
+   {
+      return;
+   }
+
+   DIR* handle = opendir(dir.c_str());
+   if(!handle)
+   {
+      throw std::runtime_error("Could not open directory " + dir);
+   }
+   std::vector<std::string> names;
+   while(struct dirent* entry = readdir(handle))
+   {
+      if(entry->d_name[0] != '.')
+      {
+         names.push_back(entry->d_name);
+      }
+   }
+   closedir(handle);
+   std::sort(names.begin(), names.end());
+
+   std::string prefix = (dir[dir.size() - 1] == '/') ? dir : dir + "/";
+   for(size_t i = 0; i < names.size(); i++)
+   {
+      std::string path = prefix + names[i];
+      struct stat info;
+      if(stat(path.c_str(), &info) != 0)
+      {
+         continue; //Dangling link, or removed since it was listed
+      }
+      if(S_ISDIR(info.st_mode))
+      {
+         CollectDirectory(path, info, suffixes, files, visited);
+      }
+      else if(S_ISREG(info.st_mode) && HasSuffix(names[i], suffixes))
+      {
+         files.push_back(path);
+      }
+   }
+}
+
+void CollectConfigFiles(const std::string& path, const std::vector<std::string>& suffixes, std::vector<std::string>& files)
+{
+   struct stat info;
+   if(stat(path.c_str(), &info) != 0)
+   {
+      throw std::runtime_error("Could not open " + path);
+   }
+   if(S_ISDIR(info.st_mode))
+   {
+      VisitedDirectories visited;
+      CollectDirectory(path, info, suffixes, files, visited);
+   }
+   else
+   {
+      files.push_back(path);
+   }
+}
+
+//Error messages carry the line as "(line N)"
+static int MessageLine(const std::string& message)
+{
+   std::string::size_type at = message.find("(line ");
+   return (at == std::string::npos) ? 0 : std::atoi(message.c_str() + at + std::strlen("(line "));
+}
+
+void LintFile(ConfigParser& parser, const std::string& path, LintResult& result)
+{
+   result.path = path;
+   result.diagnostics.clear();
+   struct stat info;
+   result.bytes = (stat(path.c_str(), &info) == 0) ? static_cast<size_t>(info.st_size) : 0;
+
+   parser.Reset();
+   parser.RecoverErrors(true);
+   try
+   {
+      parser.Parse(path);
+   }
+   catch(std::exception& e)
+   {
+      LintDiagnostic diagnostic;
+      diagnostic.message = e.what();
+      diagnostic.line = MessageLine(diagnostic.message);
+      diagnostic.column = 0;
+      std::replace(diagnostic.message.begin(), diagnostic.message.end(), '\n', ' ');
+      result.diagnostics.push_back(diagnostic);
+   }
+
+   //Recovered errors come first; anything thrown came after them
+   const std::vector<Diagnostic>& recovered = parser.Diagnostics();
+   result.diagnostics.insert(result.diagnostics.begin(), recovered.size(), LintDiagnostic());
+   for(size_t i = 0; i < recovered.size(); i++)
+   {
+      LintDiagnostic& diagnostic = result.diagnostics[i];
+      diagnostic.line = recovered[i].line;
+      diagnostic.column = recovered[i].column;
+      diagnostic.expected = recovered[i].expected;
+      diagnostic.got = recovered[i].got;
+      diagnostic.message = "expected " + recovered[i].expected + ", got " + recovered[i].got;
+   }
+}
+
+//Each thread takes the next unclaimed file until none are left
+static void LintWorker(const std::vector<std::string>& files, std::vector<LintResult>& results, std::atomic<size_t>& next)
+{
+   ConfigParser parser;
+   for(size_t i = next++; i < files.size(); i = next++)
+   {
+      LintFile(parser, files[i], results[i]);
+   }
+}
+
+std::vector<LintResult> LintFiles(const std::vector<std::string>& files, unsigned threads)
+{
+   std::vector<LintResult> results(files.size());
+   std::atomic<size_t> next(0);
+   std::vector<std::thread> workers;
+   for(unsigned i = 1; i < threads; i++)
+   {
+      workers.push_back(std::thread(LintWorker, std::cref(files), std::ref(results), std::ref(next)));
+   }
+   LintWorker(files, results, next);
+   for(size_t i = 0; i < workers.size(); i++)
+   {
+      workers[i].join();
+   }
+   return results;
+}
+
+static std::string JsonString(const std::string& text)
+{
+   std::string quoted = "\"";
+   for(size_t i = 0; i < text.size(); i++)
+   {
+      unsigned char c = text[i];
+      if(c == '"' || c == '\\')
+      {
+         quoted += '\\';
+         quoted += c;
+      }
+      else if(c < 0x20)
+      {
+         char escape[8];
+         std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+         quoted += escape;
+      }
+      else
+      {
+         quoted += c;
+      }
+   }
+   return quoted + "\"";
+}
+
+void WriteDiagnostics(const LintResult& result, bool json, std::ostream& out)
+{
+   for(size_t i = 0; i < result.diagnostics.size(); i++)
+   {
+      const LintDiagnostic& diagnostic = result.diagnostics[i];
+      if(json)
+      {
+         out << "{\"path\": " << JsonString(result.path) << ", \"line\": " << diagnostic.line <<
+            ", \"column\": " << diagnostic.column << ", \"message\": " << JsonString(diagnostic.message) <<
+            ", \"expected\": " << JsonString(diagnostic.expected) << ", \"got\": " << JsonString(diagnostic.got) << "}\n";
+      }
+      else
+      {
+         out << result.path << ":" << diagnostic.line << ":" << diagnostic.column << ": " << diagnostic.message << "\n";
+      }
+   }
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef CONFIG_LINT_H
+#define CONFIG_LINT_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstddef>
+
+namespace SimpleConfig
+{
+
+class ConfigParser;
+
+//One problem found in a file. Syntax and lexing errors have expected and
+//got set; others, such as a file that cannot be opened, only a message.
+//line and column are 0 when not known.
+typedef struct lintDiagnostic
+{
+   int line;
+   int column;
+   std::string message;
+   std::string expected;
+   std::string got;
+} LintDiagnostic;
+
+typedef struct lintResult
+{
+   std::string path;
+   size_t bytes; //Size of the file as stored, compressed or not
+   std::vector<LintDiagnostic> diagnostics;
+} LintResult;
+
+//Appends path to files, or if it is a directory every regular file below
+//it whose name ends in one of suffixes (any name if suffixes is empty).
+//Directory entries are added in sorted order; hidden ones are skipped.
+//Symbolic links are followed, but no directory is walked twice.
+//Throws std::runtime_error if path or a directory below it is unreadable.
+void CollectConfigFiles(const std::string& path, const std::vector<std::string>& suffixes, std::vector<std::string>& files);
+
+//Parses path with parser, which is reset first, and records everything
+//wrong with it. Syntax errors are recovered from, so all of them are
+//found in one pass.
+void LintFile(ConfigParser& parser, const std::string& path, LintResult& result);
+
+//Lints files on the given number of threads, each with its own reused
+//parser. Results are in the order of files.
+std::vector<LintResult> LintFiles(const std::vector<std::string>& files, unsigned threads);
+
+//Writes one line per diagnostic, either as path:line:column: message or
+//as a JSON object with path, line, column, message, expected and got
+//members
+void WriteDiagnostics(const LintResult& result, bool json, std::ostream& out);
+
+}
+
+#endif /* CONFIG_LINT_H */
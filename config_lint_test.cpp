@@ -0,0 +1,159 @@
+#include "config_lint.h"
+#include "config_parser.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+class ConfigLintTest : public ::testing::Test
+{
+protected:
+
+   ConfigLintTest()
+   {
+      char path[] = "/tmp/config_lint_testXXXXXX";
+      dir = mkdtemp(path);
+   }
+
+   ~ConfigLintTest()
+   {
+      for(size_t i = files.size(); i > 0; i--)
+      {
+         remove(files[i - 1].c_str());
+      }
+      rmdir(dir.c_str());
+   }
+
+   std::string Write(const std::string& name, const std::string& contents)
+   {
+      std::string path = dir + "/" + name;
+      std::ofstream file(path.c_str());
+      file << contents;
+      files.push_back(path);
+      return path;
+   }
+
+   std::string MakeDir(const std::string& name)
+   {
+      std::string path = dir + "/" + name;
+      mkdir(path.c_str(), 0700);
+      files.push_back(path);
+      return path;
+   }
+
+   std::string dir;
+   std::vector<std::string> files; //Removed in reverse, so directories go after their contents
+};
+
+TEST_F(ConfigLintTest, DirectoriesAreWalkedInOrder)
+{
+   Write("b.ini", "a = 1\n");
+   Write("a.ini", "a = 1\n");
+   Write("notes.txt", "not a config\n");
+   Write(".hidden.ini", "a = 1\n");
+   MakeDir("sub");
+   Write("sub/c.ini", "a = 1\n");
+
+   std::vector<std::string> suffixes(1, ".ini");
+   std::vector<std::string> found;
+   SimpleConfig::CollectConfigFiles(dir, suffixes, found);
+   ASSERT_EQ(3u, found.size());
+   EXPECT_EQ(dir + "/a.ini", found[0]);
+   EXPECT_EQ(dir + "/b.ini", found[1]);
+   EXPECT_EQ(dir + "/sub/c.ini", found[2]);
+
+   found.clear();
+   SimpleConfig::CollectConfigFiles(dir, std::vector<std::string>(), found);
+   EXPECT_EQ(4u, found.size());
+
+   EXPECT_THROW(SimpleConfig::CollectConfigFiles(dir + "/missing", suffixes, found), std::runtime_error);
+}
+
+TEST_F(ConfigLintTest, SymlinkLoopsAreWalkedOnce)
+{
+   MakeDir("sub");
+   Write("sub/a.ini", "a = 1\n");
+   std::string loop = dir + "/sub/parent";
+   ASSERT_EQ(0, symlink(dir.c_str(), loop.c_str()));
+   files.insert(files.begin() + 1, loop); //Removed before sub
+
+   std::vector<std::string> found;
+   SimpleConfig::CollectConfigFiles(dir, std::vector<std::string>(1, ".ini"), found);
+   ASSERT_EQ(1u, found.size());
+   EXPECT_EQ(dir + "/sub/a.ini", found[0]);
+}
+
+TEST_F(ConfigLintTest, ErrorsAreReportedPerFile)
+{
+   std::vector<std::string> paths;
+   for(int i = 0; i < 20; i++)
+   {
+      std::ostringstream name;
+      name << "file" << i << ".ini";
+      paths.push_back(Write(name.str(), (i % 3 == 0) ? "[s]\nkey 5\n" : "[s]\nkey = 5\n"));
+   }
+   paths.push_back(dir + "/missing.ini");
+
+   std::vector<SimpleConfig::LintResult> results = SimpleConfig::LintFiles(paths, 4);
+   ASSERT_EQ(paths.size(), results.size());
+   for(int i = 0; i < 20; i++)
+   {
+      EXPECT_EQ(paths[i], results[i].path);
+      EXPECT_EQ(i % 3 == 0 ? 10u : 12u, results[i].bytes);
+      ASSERT_EQ(i % 3 == 0 ? 1u : 0u, results[i].diagnostics.size()) << i;
+      if(i % 3 == 0)
+      {
+         EXPECT_EQ(2, results[i].diagnostics[0].line);
+         EXPECT_EQ(5, results[i].diagnostics[0].column);
+         EXPECT_EQ("expected '=' after identifier, got 5", results[i].diagnostics[0].message);
+      }
+   }
+   ASSERT_EQ(1u, results[20].diagnostics.size());
+   EXPECT_EQ(0, results[20].diagnostics[0].line);
+}
+
+TEST_F(ConfigLintTest, EveryErrorInAFileReported)
+{
+   std::string path = Write("broken.ini", "a 1\nb = 2\nc = $\n[d\ne = [1 2]\n");
+   SimpleConfig::ConfigParser parser;
+   SimpleConfig::LintResult result;
+   SimpleConfig::LintFile(parser, path, result);
+   ASSERT_EQ(4u, result.diagnostics.size());
+   EXPECT_EQ(1, result.diagnostics[0].line);
+   EXPECT_EQ(3, result.diagnostics[1].line);
+   EXPECT_EQ("$", result.diagnostics[1].got);
+   EXPECT_EQ(5, result.diagnostics[2].line); //Found at the token after "[d"
+   EXPECT_EQ(5, result.diagnostics[3].line);
+   EXPECT_EQ("2", result.diagnostics[3].got);
+
+   SimpleConfig::LintFile(parser, Write("fine.ini", "a = 1\n"), result);
+   EXPECT_TRUE(result.diagnostics.empty());
+}
+
+TEST(WriteDiagnosticsTest, TextAndJsonLines)
+{
+   SimpleConfig::LintResult result;
+   result.path = "conf/\"odd\".ini";
+   result.bytes = 10;
+   SimpleConfig::LintDiagnostic diagnostic = {3, 7, "expected '=', got \\", "'='", "\\"};
+   result.diagnostics.push_back(diagnostic);
+
+   std::ostringstream text;
+   SimpleConfig::WriteDiagnostics(result, false, text);
+   EXPECT_EQ("conf/\"odd\".ini:3:7: expected '=', got \\\n", text.str());
+
+   std::ostringstream json;
+   SimpleConfig::WriteDiagnostics(result, true, json);
+   EXPECT_EQ("{\"path\": \"conf/\\\"odd\\\".ini\", \"line\": 3, \"column\": 7, \"message\": \"expected '=', got \\\\\", "
+      "\"expected\": \"'='\", \"got\": \"\\\\\"}\n", json.str());
+}
+
+}
@@ -1,13 +1,170 @@
 #include "config_parser.h"
 #include "parse_utilities.h"
+#include "memory_stream.h"
+#include "compressed_stream.h"
+#include "parse_cache.h"
+#include "spsc_ring.h"
 #include <fstream>
 #include <stdexcept>
 #include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <thread>
+#include <exception>
 
 namespace SimpleConfig
 {
 
-ConfigParser::ConfigParser()
+//Pulls tokens straight from the lexer, optionally recording the layout
+class StreamTokenSource : public TokenSource
+{
+public:
+   StreamTokenSource(ConfigLexer& lexer, std::istream& source, std::vector<LayoutPiece>* layout):
+      mLexer(lexer), mSource(source), mLayout(layout) {}
+
+   virtual void Next(Token& tok)
+   {
+      mLexer.GetNextToken(mSource, tok);
+      if(mLayout)
+      {
+         mLayout->push_back(LayoutPiece());
+         mLayout->back().trivia = mLexer.GetTrivia();
+         mLayout->back().text = (tok.type == STRING) ? mLexer.GetStringSource() : TokenSourceText(tok);
+      }
+   }
+
+private:
+   ConfigLexer& mLexer;
+   std::istream& mSource;
+   std::vector<LayoutPiece>* mLayout;
+};
+
+//Runs the lexer on its own thread and hands its tokens to the parsing
+//thread in batches through a single-producer/single-consumer ring.
+//Lexer errors are passed along the ring and rethrown by Next(); if the
+//parser stops early the lexer thread is told to stop and joined.
+class PipelinedTokenSource : public TokenSource
+{
+public:
+   static const size_t BATCH_SIZE = 512;
+   static const size_t RING_BATCHES = 16;
+
+   PipelinedTokenSource(ConfigLexer& lexer, std::istream& source):
+      mLexer(lexer), mSource(source), mRing(RING_BATCHES), mStop(false), mPos(0)
+   {
+      mThread = std::thread(&PipelinedTokenSource::Produce, this);
+   }
+
+   ~PipelinedTokenSource()
+   {
+      mStop.store(true, std::memory_order_relaxed);
+      mThread.join();
+   }
+
+   virtual void Next(Token& tok)
+   {
+      while(mPos == mBatch.tokens.size())
+      {
+         if(mBatch.last)
+         {
+            if(mBatch.error)
+            {
+               std::rethrow_exception(mBatch.error);
+            }
+            tok = mBatch.tokens.back(); //END_OF_FILE again
+            return;
+         }
+         mBatch.tokens.clear();
+         while(!mRing.TryPop(mBatch))
+         {
+            std::this_thread::yield();
+         }
+         mPos = 0;
+      }
+      tok = mBatch.tokens[mPos++];
+   }
+
+private:
+   PipelinedTokenSource(const PipelinedTokenSource&);
+   PipelinedTokenSource& operator=(const PipelinedTokenSource&);
+
+   typedef struct batch
+   {
+      batch(): last(false) {}
+      std::vector<Token> tokens;
+      bool last;                  //Nothing follows; ends with END_OF_FILE or error
+      std::exception_ptr error;
+   } Batch;
+
+   void Produce()
+   {
+      Batch batch;
+      batch.tokens.reserve(BATCH_SIZE);
+      while(!batch.last)
+      {
+         try
+         {
+            while(batch.tokens.size() < BATCH_SIZE)
+            {
+               batch.tokens.push_back(mLexer.GetNextToken(mSource));
+               if(batch.tokens.back().type == END_OF_FILE)
+               {
+                  batch.last = true;
+                  break;
+               }
+            }
+         }
+         catch(...)
+         {
+            batch.error = std::current_exception();
+            batch.last = true;
+         }
+
+         while(!mRing.TryPush(batch))
+         {
+            if(mStop.load(std::memory_order_relaxed))
+            {
+               return;
+            }
+            std::this_thread::yield();
+         }
+         batch.tokens.clear();
+         batch.last = false;
+         batch.error = std::exception_ptr();
+         if(mStop.load(std::memory_order_relaxed))
+         {
+            return;
+         }
+      }
+   }
+
+   ConfigLexer& mLexer;
+   std::istream& mSource;
+   SpscRing<Batch> mRing;
+   std::atomic<bool> mStop;
+   std::thread mThread;
+   Batch mBatch;       //Batch being consumed
+   size_t mPos;
+};
+
+
+SyntaxError::SyntaxError(const std::string& message, const Diagnostic& diagnostic):
+   std::runtime_error(message), mDiagnostic(diagnostic)
+{}
+
+SyntaxError::~SyntaxError() throw()
+{}
+
+const Diagnostic& SyntaxError::GetDiagnostic() const
+{
+   return mDiagnostic;
+}
+
+
+ConfigParser::ConfigParser(): mBorrowedBuf(NULL), mBorrowedData(NULL), mMemoryBuf(NULL), mRecover(false),
+   mKeepLayout(false), mPipelined(false)
 {}
 
 ConfigParser::~ConfigParser()
@@ -26,64 +183,588 @@ void ConfigParser::Parse(const char *filename)
       std::string fName(filename);
       throw std::runtime_error("Could not open file " + fName);
    }
-   Parse(file);
+
+   std::string path(filename);
+   std::string savedDir = mIncludeDir;
+   std::string::size_type slash = path.rfind('/');
+   mIncludeDir = (slash == std::string::npos) ? "" : path.substr(0, slash + 1);
+   try
+   {
+      ParseFileStream(file);
+   }
+   catch(...)
+   {
+      mIncludeDir = savedDir;
+      throw;
+   }
+   mIncludeDir = savedDir;
 }
 
+//Compressed files are decompressed on the fly and never reach the disk
+void ConfigParser::ParseFileStream(std::istream& file)
+{
+   Compression compression = DetectCompression(file.rdbuf());
+   if(compression == NO_COMPRESSION)
+   {
+      Parse(file);
+      return;
+   }
+
+   DecompressingStreamBuf buf(file.rdbuf(), compression);
+   std::istream configStream(&buf);
+   //Let decompression errors through instead of reading them as the end
+   configStream.exceptions(std::ios_base::badbit);
+   Parse(configStream);
+}
+
+void ConfigParser::Parse(const char *data, size_t length, BufferOwnership ownership /* =COPY_BUFFER */)
+{
+   MemoryStreamBuf buf(data, length);
+   std::istream configStream(&buf);
+   if(ownership == BORROW_BUFFER)
+   {
+      mBorrowedBuf = &buf;
+      mBorrowedData = data;
+   }
+   mMemoryBuf = &buf;
+
+   try
+   {
+      Parse(configStream);
+   }
+   catch(...)
+   {
+      mBorrowedBuf = NULL;
+      mBorrowedData = NULL;
+      mMemoryBuf = NULL;
+      throw;
+   }
+   mBorrowedBuf = NULL;
+   mBorrowedData = NULL;
+   mMemoryBuf = NULL;
+}
+
+//Recording layout and borrowing strings both need the parser to see
+//the stream position of each token, so those parses are never pipelined
 void ConfigParser::Parse(std::istream& configStream)
 {
-   mCurToken = lexer.GetNextToken(configStream);
-   mCurSection = "";
+   if(mRecover && !mMemoryBuf)
+   {
+      std::string text((std::istreambuf_iterator<char>(configStream)), std::istreambuf_iterator<char>());
+      Parse(text.data(), text.size());
+      return;
+   }
+
+   lexer.SetLine(1);
+   if(mPipelined && !mKeepLayout && !mBorrowedBuf && !mRecover)
+   {
+      //The lexer thread reads ahead of the token being parsed, so the
+      //buffer position says nothing about its column
+      mMemoryBuf = NULL;
+      PipelinedTokenSource tokens(lexer, configStream);
+      ParseTokens(tokens);
+   }
+   else
+   {
+      StreamTokenSource tokens(lexer, configStream, mKeepLayout ? &mLayout : NULL);
+      if(mRecover)
+      {
+         ParseRecovering(tokens, configStream);
+      }
+      else
+      {
+         ParseTokens(tokens);
+      }
+   }
+}
+
+void ConfigParser::ParseTokens(TokenSource& tokens)
+{
+   BeginParse();
+   tokens.Next(mCurToken);
    while(mCurToken.type != END_OF_FILE)
    {
-      switch(mCurToken.type)
+      ParseStatement(tokens);
+      tokens.Next(mCurToken);
+   }
+   FinishParse();
+}
+
+//As ParseTokens, but each statement is tried on its own. String
+//sources are recorded meanwhile so that token columns can be found.
+void ConfigParser::ParseRecovering(TokenSource& tokens, std::istream& source)
+{
+   BeginParse();
+   lexer.RecordTrivia(true);
+   try
+   {
+      bool haveToken = false;
+      while(true)
       {
-      case LEFT_BRACKET:
-         ParseSectionHeader(configStream);
-         break;
-      case IDENTIFIER:
-         ParseAssignment(configStream);
-         break;
-      default:
-         ParseError("assignment or section header");
-         break;
+         int line = 0;
+         try
+         {
+            if(!haveToken)
+            {
+               tokens.Next(mCurToken);
+            }
+            haveToken = false;
+            if(mCurToken.type == END_OF_FILE)
+            {
+               break;
+            }
+            line = mCurToken.lineNum;
+            ParseStatement(tokens);
+         }
+         catch(SyntaxError& e)
+         {
+            mDiagnostics.push_back(e.GetDiagnostic());
+            if(mCurToken.type == END_OF_FILE)
+            {
+               break;
+            }
+            //A statement cut short by a line break leaves the next one intact
+            if(mCurToken.lineNum > line && (mCurToken.type == IDENTIFIER || mCurToken.type == LEFT_BRACKET))
+            {
+               haveToken = true;
+               continue;
+            }
+            lexer.SkipLine(source);
+         }
+         catch(LexError& e)
+         {
+            mDiagnostics.push_back(e.GetDiagnostic());
+            lexer.SkipLine(source);
+         }
+      }
+   }
+   catch(...)
+   {
+      lexer.RecordTrivia(mKeepLayout);
+      throw;
+   }
+   lexer.RecordTrivia(mKeepLayout);
+   FinishParse();
+}
+
+void ConfigParser::PipelineLexing(bool pipeline)
+{
+   mPipelined = pipeline;
+}
+
+void ConfigParser::RecoverErrors(bool recover)
+{
+   mRecover = recover;
+}
+
+const std::vector<Diagnostic>& ConfigParser::Diagnostics() const
+{
+   return mDiagnostics;
+}
+
+//Index nodes are detached rather than freed, and picked up again by
+//InsertKey in the next parse
+void ConfigParser::Reset()
+{
+   while(!parseMap.empty())
+   {
+      KeyIndex& keys = parseMap.begin()->second;
+      while(!keys.empty())
+      {
+         mSpare.keys.push_back(keys.extract(keys.begin()));
       }
-      mCurToken = lexer.GetNextToken(configStream);
+      mSpare.sections.push_back(parseMap.extract(parseMap.begin()));
    }
+   mValues.Clear();
+   mDottedSections.clear();
+   mInherited.clear();
+   mLayout.clear();
+   mUnresolved.clear();
+   mIncludes.clear();
+   mAssigned.clear();
+   mCurSection.clear();
+   mDiagnostics.clear();
 }
 
-void ConfigParser::ParseSectionHeader(std::istream& configStream)
+void ConfigParser::BeginParse()
 {
-   mCurToken = lexer.GetNextToken(configStream);
+   mCurSection.clear();
+   mDiagnostics.clear();
+   mIncludes.clear();
+   mAssigned.clear();
+}
+
+void ConfigParser::FinishParse()
+{
+   MergeIncludes();
+   BuildInheritance();
+   ResolveReferences();
+}
+
+//For every dotted section, merges the keys of its ancestors (nearest
+//first) with its own, so that an inherited lookup is a single probe.
+//Sections are handled parents first, so each can start from the merged
+//index of its nearest ancestor that has keys.
+void ConfigParser::BuildInheritance()
+{
+   mInherited.clear();
+
+   std::set<std::string> dotted(mDottedSections);
+   for(SectionIndex::const_iterator sectionIt = parseMap.begin(); sectionIt != parseMap.end(); ++sectionIt)
+   {
+      if(sectionIt->first.find('.') != std::string::npos)
+      {
+         dotted.insert(sectionIt->first);
+      }
+   }
+
+   std::vector<std::pair<size_t, std::string> > byDepth;
+   for(std::set<std::string>::const_iterator it = dotted.begin(); it != dotted.end(); ++it)
+   {
+      byDepth.push_back(std::make_pair(static_cast<size_t>(std::count(it->begin(), it->end(), '.')), *it));
+   }
+   std::sort(byDepth.begin(), byDepth.end());
+
+   for(size_t i = 0; i < byDepth.size(); i++)
+   {
+      const std::string& section = byDepth[i].second;
+      const KeyIndex* parent = NULL;
+      std::string ancestor = section;
+      std::string::size_type dot;
+      while(parent == NULL && (dot = ancestor.rfind('.')) != std::string::npos)
+      {
+         ancestor.erase(dot);
+         parent = FindSection(ancestor);
+      }
+      if(parent == NULL)
+      {
+         continue;
+      }
+
+      KeyIndex merged(*parent);
+      SectionIndex::const_iterator own = parseMap.find(section);
+      if(own != parseMap.end())
+      {
+         for(KeyIndex::const_iterator keyIt = own->second.begin(); keyIt != own->second.end(); ++keyIt)
+         {
+            merged[keyIt->first] = keyIt->second;
+         }
+      }
+      mInherited[section].swap(merged);
+   }
+}
+
+void ConfigParser::KeepLayout(bool keep)
+{
+   mKeepLayout = keep;
+   lexer.RecordTrivia(keep);
+   if(!keep)
+   {
+      std::vector<LayoutPiece>().swap(mLayout);
+   }
+}
+
+//Parses the header or assignment starting at mCurToken
+void ConfigParser::ParseStatement(TokenSource& tokens)
+{
+   switch(mCurToken.type)
+   {
+   case LEFT_BRACKET:
+      ParseSectionHeader(tokens);
+      break;
+   case IDENTIFIER:
+      ParseAssignment(tokens);
+      break;
+   default:
+      ParseError("assignment or section header");
+      break;
+   }
+}
+
+void ConfigParser::ParseSectionHeader(TokenSource& tokens)
+{
+   tokens.Next(mCurToken);
    if(mCurToken.type == IDENTIFIER)
    {
       mCurSection = mCurToken.lexeme;
+      if(mCurSection.find('.') != std::string::npos)
+      {
+         if(mCurSection.find("..") != std::string::npos || mCurSection[mCurSection.size() - 1] == '.')
+         {
+            ParseError("section name parts separated by single '.'");
+         }
+         mDottedSections.insert(mCurSection);
+      }
    }
    else
    {
       mCurSection = "";
    }
 
-   mCurToken = lexer.GetNextToken(configStream);
+   tokens.Next(mCurToken);
    if(mCurToken.type != RIGHT_BRACKET)
    {
       ParseError("']' in section header");
    }
 }
 
-void ConfigParser::ParseAssignment(std::istream& configStream)
+void ConfigParser::ParseAssignment(TokenSource& tokens)
 {
-   std::string id = mCurToken.lexeme;
-   mCurToken = lexer.GetNextToken(configStream);
+   std::string& id = mCurKey;
+   id = mCurToken.lexeme;
+   tokens.Next(mCurToken);
+   if(id == "include" && mCurToken.type == STRING)
+   {
+      ParseInclude(mCurToken);
+      return;
+   }
    if(mCurToken.type != EQUALS)
    {
       ParseError("'=' after identifier");
    }
-   mCurToken = lexer.GetNextToken(configStream);
+   if(id.find('.') != std::string::npos)
+   {
+      mCurToken.lexeme = id;
+      ParseError("key name without '.'");
+   }
+   if(!mIncludes.empty())
+   {
+      mAssigned.push_back(std::make_pair(mCurSection, id));
+   }
+   tokens.Next(mCurToken);
+   if(mCurToken.type == LEFT_BRACKET)
+   {
+      ParseList(tokens, id);
+      return;
+   }
    if(!IsLiteral(mCurToken))
    {
       ParseError("literal after '='");
    }
-   parseMap[mCurSection][id] = mCurToken;
+   StoreValue(id, mCurToken);
+   if(mCurToken.type == STRING && mCurToken.lexeme.find("${") != std::string::npos)
+   {
+      mUnresolved.push_back(std::make_pair(mCurSection, id));
+   }
+}
+
+//Builds the list in mListScratch, overwriting the elements left there
+//by an earlier list so their capacity is reused
+void ConfigParser::ParseList(TokenSource& tokens, const std::string& id)
+{
+   ListValue& list = mListScratch;
+   size_t count = 0;
+   int line = mCurToken.lineNum;
+   list.text = "[";
+   list.integers.clear();
+   list.reals.clear();
+   bool integers = true;
+   bool numbers = true;
+
+   tokens.Next(mCurToken);
+   while(mCurToken.type != RIGHT_BRACKET)
+   {
+      if(count > 0)
+      {
+         if(mCurToken.type != COMMA)
+         {
+            ParseError("',' or ']' in list");
+         }
+         list.text += ", ";
+         tokens.Next(mCurToken);
+      }
+      if(!IsLiteral(mCurToken))
+      {
+         ParseError("literal in list");
+      }
+
+      //Numbers are converted once here so lookups can hand out the arrays directly
+      integers = integers && mCurToken.type == INTEGER;
+      numbers = numbers && (mCurToken.type == INTEGER || mCurToken.type == REAL_NUMBER);
+      try
+      {
+         if(integers)
+         {
+            list.integers.push_back(Str2LongLong(mCurToken.lexeme.c_str()));
+         }
+         if(numbers)
+         {
+            list.reals.push_back(Str2Double(mCurToken.lexeme.c_str()));
+         }
+      }
+      catch(std::logic_error&)
+      {
+         ParseError("number in list");
+      }
+
+      AppendTokenSourceText(list.text, mCurToken);
+      if(count < list.elements.size())
+      {
+         list.elements[count] = mCurToken;
+      }
+      else
+      {
+         list.elements.push_back(mCurToken);
+      }
+      count++;
+      tokens.Next(mCurToken);
+   }
+   list.text += "]";
+   list.elements.resize(count);
+
+   if(!integers)
+   {
+      list.integers.clear();
+   }
+   if(!numbers)
+   {
+      list.reals.clear();
+   }
+
+   StoreList(id, list, line);
+}
+
+//Starts parsing the included file on another thread. Relative paths
+//are relative to the directory of the including file.
+void ConfigParser::ParseInclude(const Token& path)
+{
+   std::string resolved = path.lexeme;
+   if(resolved.empty() || resolved[0] != '/')
+   {
+      resolved = mIncludeDir + resolved;
+   }
+
+   mIncludes.push_back(PendingInclude());
+   mIncludes.back().section = mCurSection;
+   mIncludes.back().position = mAssigned.size();
+   mIncludes.back().result = std::async(std::launch::async,
+      &ParseCache::Acquire, &ParseCache::Global(), resolved, mIncludeKey).share();
+}
+
+//Applies the included files in order. An included value replaces what
+//this file assigned before the include, and is itself replaced by what
+//this file assigns after it.
+void ConfigParser::MergeIncludes()
+{
+   if(mIncludes.empty())
+   {
+      return;
+   }
+   std::vector<PendingInclude> includes;
+   includes.swap(mIncludes);
+
+   //Position just past the last assignment of each key in mAssigned
+   std::map<std::pair<std::string, std::string>, size_t> lastAssigned;
+   for(size_t i = 0; i < mAssigned.size(); i++)
+   {
+      lastAssigned[mAssigned[i]] = i + 1;
+   }
+   mAssigned.clear();
+
+   std::string savedSection = mCurSection;
+   for(size_t i = 0; i < includes.size(); i++)
+   {
+      std::shared_ptr<const ConfigParser> included = includes[i].result.get();
+      for(SectionIndex::const_iterator sectionIt = included->parseMap.begin(); sectionIt != included->parseMap.end(); ++sectionIt)
+      {
+         mCurSection = sectionIt->first.empty() ? includes[i].section : sectionIt->first;
+         for(KeyIndex::const_iterator keyIt = sectionIt->second.begin(); keyIt != sectionIt->second.end(); ++keyIt)
+         {
+            std::map<std::pair<std::string, std::string>, size_t>::const_iterator last =
+               lastAssigned.find(std::make_pair(mCurSection, keyIt->first));
+            if(last != lastAssigned.end() && last->second > includes[i].position)
+            {
+               continue;
+            }
+
+            const ListValue* list = included->mValues.List(keyIt->second);
+            if(list)
+            {
+               ListValue copy(*list);
+               StoreList(keyIt->first, copy, included->mValues.Line(keyIt->second));
+            }
+            else
+            {
+               StoreValue(keyIt->first, included->mValues.Get(keyIt->second));
+            }
+         }
+      }
+   }
+   mCurSection = savedSection;
+}
+
+//Adds the value, or overwrites it in place if the key already exists
+//Inserts into map at hint, in a node left by Reset if there is one
+template<typename Map>
+static typename Map::iterator InsertNode(Map& map, typename Map::iterator hint, const typename Map::key_type& key,
+   const typename Map::mapped_type& value, std::vector<typename Map::node_type>& spare)
+{
+   if(spare.empty())
+   {
+      return map.insert(hint, std::make_pair(key, value));
+   }
+   typename Map::node_type node = std::move(spare.back());
+   spare.pop_back();
+   node.key() = key;
+   node.mapped() = value;
+   return map.insert(hint, std::move(node));
+}
+
+//Finds key in the current section, or adds it with the index the next
+//value stored will get
+std::pair<ConfigParser::KeyIndex::iterator, bool> ConfigParser::InsertKey(const std::string& key)
+{
+   SectionIndex::iterator sectionIt = parseMap.lower_bound(mCurSection);
+   if(sectionIt == parseMap.end() || sectionIt->first != mCurSection)
+   {
+      sectionIt = InsertNode(parseMap, sectionIt, mCurSection, KeyIndex(), mSpare.sections);
+   }
+
+   KeyIndex& keys = sectionIt->second;
+   KeyIndex::iterator keyIt = keys.lower_bound(key);
+   if(keyIt != keys.end() && keyIt->first == key)
+   {
+      return std::make_pair(keyIt, false);
+   }
+   return std::make_pair(InsertNode(keys, keyIt, key, mValues.Size(), mSpare.keys), true);
+}
+
+void ConfigParser::StoreValue(const std::string& key, const Token& tok)
+{
+   //A long string read from a borrowed buffer ends right before the
+   //current read position; point at it if its bytes are unchanged
+   const char* external = NULL;
+   if(mBorrowedBuf && tok.type == STRING && tok.lexeme.size() > Value::MAX_INLINE)
+   {
+      size_t end = mBorrowedBuf->Position() - 1;
+      if(end >= tok.lexeme.size() && tok.lexeme.compare(0, std::string::npos, mBorrowedData + end - tok.lexeme.size(), tok.lexeme.size()) == 0)
+      {
+         external = mBorrowedData + end - tok.lexeme.size();
+      }
+   }
+
+   std::pair<KeyIndex::iterator, bool> inserted = InsertKey(key);
+   if(inserted.second)
+   {
+      mValues.Add(tok, external);
+   }
+   else
+   {
+      mValues.Set(inserted.first->second, tok, external);
+   }
+}
+
+void ConfigParser::StoreList(const std::string& key, ListValue& list, int line)
+{
+   std::pair<KeyIndex::iterator, bool> inserted = InsertKey(key);
+   if(inserted.second)
+   {
+      mValues.AddList(list, line);
+   }
+   else
+   {
+      mValues.SetList(inserted.first->second, list, line);
+   }
 }
 
 bool ConfigParser::IsLiteral(const Token& tok)
@@ -91,122 +772,424 @@ bool ConfigParser::IsLiteral(const Token& tok)
    return (tok.type == BOOL) || (tok.type == INTEGER) || (tok.type == REAL_NUMBER) || (tok.type == STRING);
 }
 
-Token ConfigParser::Lookup(const std::string& section, const std::string& key) const
+//Keys visible in section, including inherited ones. NULL if none.
+const ConfigParser::KeyIndex* ConfigParser::FindSection(const std::string& section) const
 {
-   std::map<std::string, std::map<std::string, Token> >::const_iterator sectionIt = parseMap.find(section);
+   if(!mInherited.empty())
+   {
+      SectionIndex::const_iterator inheritedIt = mInherited.find(section);
+      if(inheritedIt != mInherited.end())
+      {
+         return &inheritedIt->second;
+      }
+   }
+   SectionIndex::const_iterator sectionIt = parseMap.find(section);
    if(sectionIt == parseMap.end())
    {
-      throw std::invalid_argument("Section " + section + " not found");
+      return NULL;
    }
+   return &sectionIt->second;
+}
 
-   std::map<std::string, Token>::const_iterator keyIt = sectionIt->second.find(key);
-   if(keyIt == sectionIt->second.end())
+//Every section with its visible keys; dotted sections include the
+//inherited ones
+void ConfigParser::VisibleSections(std::map<std::string, const KeyIndex*>& sections) const
+{
+   for(SectionIndex::const_iterator sectionIt = parseMap.begin(); sectionIt != parseMap.end(); ++sectionIt)
+   {
+      sections[sectionIt->first] = &sectionIt->second;
+   }
+   for(SectionIndex::const_iterator sectionIt = mInherited.begin(); sectionIt != mInherited.end(); ++sectionIt)
    {
-      throw std::invalid_argument("Key" + key + " not found in section " + section);
+      sections[sectionIt->first] = &sectionIt->second;
    }
+}
 
-   return keyIt->second;
+bool ConfigParser::FindIndex(const std::string& section, const std::string& key, size_t& index) const
+{
+   const KeyIndex* keys = FindSection(section);
+   if(keys == NULL)
+   {
+      return false;
+   }
+
+   KeyIndex::const_iterator keyIt = keys->find(key);
+   if(keyIt == keys->end())
+   {
+      return false;
+   }
+
+   index = keyIt->second;
+   return true;
+}
+
+//Approximate heap bytes held by the parsed values and their index
+size_t ConfigParser::MemoryUsage() const
+{
+   //A map node holds the pair plus a parent/left/right pointer and colour
+   const size_t nodeOverhead = 4 * sizeof(void*);
+   size_t bytes = mValues.MemoryUsage();
+   for(SectionIndex::const_iterator sectionIt = parseMap.begin(); sectionIt != parseMap.end(); ++sectionIt)
+   {
+      bytes += sizeof(SectionIndex::value_type) + nodeOverhead + sectionIt->first.capacity();
+      for(KeyIndex::const_iterator keyIt = sectionIt->second.begin(); keyIt != sectionIt->second.end(); ++keyIt)
+      {
+         bytes += sizeof(KeyIndex::value_type) + nodeOverhead + keyIt->first.capacity();
+      }
+   }
+   bytes += mSpare.sections.capacity() * sizeof(SectionIndex::node_type) + mSpare.keys.capacity() * sizeof(KeyIndex::node_type);
+   for(size_t i = 0; i < mSpare.sections.size(); i++)
+   {
+      bytes += sizeof(SectionIndex::value_type) + nodeOverhead + mSpare.sections[i].key().capacity();
+   }
+   for(size_t i = 0; i < mSpare.keys.size(); i++)
+   {
+      bytes += sizeof(KeyIndex::value_type) + nodeOverhead + mSpare.keys[i].key().capacity();
+   }
+   return bytes;
 }
 
+bool ConfigParser::Find(const std::string& section, const std::string& key, Token& value) const
+{
+   size_t index;
+   if(!FindIndex(section, key, index))
+   {
+      return false;
+   }
+   value = mValues.Get(index);
+   return true;
+}
 
 bool ConfigParser::LookupBoolean(const std::string& section, const std::string& key) const
 {
-   bool value;
-   Token tok = Lookup(section, key); //Throws if not found
+   size_t index;
+   if(FindIndex(section, key, index))
+   {
+      const Value& cell = mValues.Cell(index);
+      if(cell.GetStorage() == Value::NUMBER_BITS)
+      {
+         return cell.Integer() != 0;
+      }
+   }
+   return ConfigSource::LookupBoolean(section, key);
+}
 
-   try
+double ConfigParser::LookupDouble(const std::string& section, const std::string& key) const
+{
+   size_t index;
+   if(FindIndex(section, key, index))
    {
-      value = Str2Bool(tok.lexeme);
+      const Value& cell = mValues.Cell(index);
+      if(cell.GetStorage() == Value::REAL_BITS)
+      {
+         return cell.Real();
+      }
+      if(cell.GetStorage() == Value::NUMBER_BITS && cell.Type() == INTEGER)
+      {
+         return static_cast<double>(cell.Integer());
+      }
    }
-   catch(std::logic_error& e)
+   return ConfigSource::LookupDouble(section, key);
+}
+
+int ConfigParser::LookupInteger(const std::string& section, const std::string& key) const
+{
+   size_t index;
+   if(FindIndex(section, key, index))
+   {
+      const Value& cell = mValues.Cell(index);
+      if(cell.GetStorage() == Value::NUMBER_BITS && cell.Type() == INTEGER)
+      {
+         return static_cast<int>(cell.Integer());
+      }
+   }
+   return ConfigSource::LookupInteger(section, key);
+}
+
+std::string ConfigParser::LookupString(const std::string& section, const std::string& key) const
+{
+   size_t index;
+   if(!FindIndex(section, key, index))
    {
-      ConversionError(section, key, e.what(), tok.lineNum);
+      return ConfigSource::LookupString(section, key); //Throws
+   }
+   return mValues.Text(index);
+}
+
+size_t ConfigParser::LookupBatch(const std::string& section, LookupRequest* requests, size_t count) const
+{
+   const KeyIndex* keys = FindSection(section);
+   if(keys == NULL)
+   {
+      for(size_t i = 0; i < count; i++)
+      {
+         requests[i].status = LOOKUP_MISSING;
+      }
+      return count;
+   }
+
+   size_t failed = 0;
+   for(size_t i = 0; i < count; i++)
+   {
+      LookupRequest& request = requests[i];
+      KeyIndex::const_iterator keyIt = keys->find(request.key);
+      if(keyIt == keys->end())
+      {
+         request.status = LOOKUP_MISSING;
+         failed++;
+         continue;
+      }
+
+      const Value& cell = mValues.Cell(keyIt->second);
+      request.status = LOOKUP_OK;
+      if(request.type == BOOLEAN_VALUE && cell.GetStorage() == Value::NUMBER_BITS)
+      {
+         *static_cast<bool*>(request.destination) = cell.Integer() != 0;
+      }
+      else if(request.type == DOUBLE_VALUE && cell.GetStorage() == Value::REAL_BITS)
+      {
+         *static_cast<double*>(request.destination) = cell.Real();
+      }
+      else if(request.type == DOUBLE_VALUE && cell.GetStorage() == Value::NUMBER_BITS && cell.Type() == INTEGER)
+      {
+         *static_cast<double*>(request.destination) = static_cast<double>(cell.Integer());
+      }
+      else if(request.type == INTEGER_VALUE && cell.GetStorage() == Value::NUMBER_BITS && cell.Type() == INTEGER)
+      {
+         *static_cast<int*>(request.destination) = static_cast<int>(cell.Integer());
+      }
+      else if(!ConvertText(mValues.Text(keyIt->second), request))
+      {
+         request.status = LOOKUP_WRONG_TYPE;
+         failed++;
+      }
    }
+   return failed;
+}
+
 
-   return value;
+ConfigParser::SectionRange ConfigParser::Sections() const
+{
+   return SectionRange(parseMap);
 }
 
-bool ConfigParser::LookupBoolean(const std::string& key) const
+ConfigParser::SectionRange ConfigParser::Sections(const std::string& prefix) const
 {
-   return LookupBoolean("", key);
+   return SectionRange(parseMap, prefix);
 }
 
-double ConfigParser::LookupDouble(const std::string& section, const std::string& key) const
+ConfigParser::KeyRange ConfigParser::Keys(const std::string& section) const
 {
-   double value;
-   Token tok = Lookup(section, key); //Throws if not found
+   static const KeyIndex noKeys;
+   const KeyIndex* keys = FindSection(section);
+   return KeyRange(keys == NULL ? noKeys : *keys);
+}
 
-   try
+ConfigParser::KeyRange ConfigParser::Keys(const std::string& section, const std::string& prefix) const
+{
+   static const KeyIndex noKeys;
+   const KeyIndex* keys = FindSection(section);
+   return KeyRange(keys == NULL ? noKeys : *keys, prefix);
+}
+
+
+//Expands ${section.key} and ${ENV} references in the string values
+//collected during the parse. Each value is expanded once; values it
+//refers to are expanded first (depth first), so lookups never pay for
+//expansion.
+void ConfigParser::ResolveReferences()
+{
+   std::vector<std::pair<std::string, std::string> > pending;
+   pending.swap(mUnresolved);
+
+   //Only values from this parse are expanded; older ones are already
+   //final. A key assigned a list or number after its string is skipped.
+   std::map<size_t, ResolveState> state;
+   for(size_t i = 0; i < pending.size(); i++)
    {
-      value = Str2Double(tok.lexeme);
+      size_t index = parseMap[pending[i].first][pending[i].second];
+      if(mValues.Type(index) == STRING)
+      {
+         state[index] = UNRESOLVED;
+      }
    }
-   catch(std::logic_error& e)
+
+   std::vector<std::string> chain;
+   for(size_t i = 0; i < pending.size(); i++)
    {
-      ConversionError(section, key, e.what(), tok.lineNum);
+      size_t index = parseMap[pending[i].first][pending[i].second];
+      if(state.count(index))
+      {
+         ResolveValue(index, pending[i].first + "." + pending[i].second, state, chain);
+      }
    }
-   return value;
 }
 
-double ConfigParser::LookupDouble(const std::string& key) const
+void ConfigParser::ResolveValue(size_t index, const std::string& name, std::map<size_t, ResolveState>& state, std::vector<std::string>& chain)
 {
-   return LookupDouble("", key);
-}
+   std::ostringstream location;
+   location << name << " (line " << mValues.Line(index) << ")";
 
+   ResolveState& current = state[index];
+   if(current == RESOLVED)
+   {
+      return;
+   }
+   if(current == RESOLVING)
+   {
+      std::stringstream msgBuf;
+      msgBuf << "Reference cycle: ";
+      for(size_t i = 0; i < chain.size(); i++)
+      {
+         msgBuf << chain[i] << " -> ";
+      }
+      msgBuf << location.str();
+      throw std::runtime_error(msgBuf.str());
+   }
+   current = RESOLVING;
+   chain.push_back(location.str());
 
-int ConfigParser::LookupInteger(const std::string& section, const std::string& key) const
+   Token tok = mValues.Get(index);
+   std::string expanded;
+   std::string::size_type pos = 0;
+   while(true)
+   {
+      std::string::size_type start = tok.lexeme.find("${", pos);
+      if(start == std::string::npos)
+      {
+         expanded.append(tok.lexeme, pos, std::string::npos);
+         break;
+      }
+      std::string::size_type end = tok.lexeme.find('}', start);
+      if(end == std::string::npos)
+      {
+         throw std::runtime_error("Unterminated reference in " + location.str());
+      }
+      expanded.append(tok.lexeme, pos, start - pos);
+
+      std::string ref = tok.lexeme.substr(start + 2, end - start - 2);
+      std::string::size_type dot = ref.rfind('.');
+      if(dot == std::string::npos)
+      {
+         const char* env = std::getenv(ref.c_str());
+         if(env == NULL)
+         {
+            throw std::runtime_error("Undefined environment variable ${" + ref + "} in " + location.str());
+         }
+         expanded.append(env);
+      }
+      else
+      {
+         std::string section = ref.substr(0, dot);
+         std::string key = ref.substr(dot + 1);
+         size_t target;
+         if(!FindIndex(section, key, target))
+         {
+            throw std::runtime_error("Undefined reference ${" + ref + "} in " + location.str());
+         }
+         if(state.count(target))
+         {
+            ResolveValue(target, ref, state, chain);
+         }
+         expanded.append(mValues.Text(target));
+      }
+      pos = end + 1;
+   }
+
+   tok.lexeme = expanded;
+   mValues.Set(index, tok);
+   state[index] = RESOLVED;
+   chain.pop_back();
+}
+
+const ListValue& ConfigParser::FindList(const std::string& section, const std::string& key) const
 {
-   int value;
-   Token tok = Lookup(section, key); //Throws if not found
+   size_t index = 0;
+   if(!FindIndex(section, key, index))
+   {
+      Lookup(section, key); //Throws
+   }
 
-   try
+   const ListValue* list = mValues.List(index);
+   if(list == NULL)
    {
-      value = Str2Int(tok.lexeme);
+      ConversionError(section, key, "value is not a list", mValues.Line(index));
    }
-   catch(std::logic_error& e)
+   return *list;
+}
+
+ArrayView<long long> ConfigParser::LookupIntegerList(const std::string& section, const std::string& key) const
+{
+   const ListValue& list = FindList(section, key);
+   if(list.integers.size() != list.elements.size())
    {
-      ConversionError(section, key, e.what(), tok.lineNum);
+      ConversionError(section, key, "list elements are not all integers", list.elements.front().lineNum);
    }
+   return ArrayView<long long>(list.integers.empty() ? NULL : &list.integers[0], list.integers.size());
+}
 
-   return value;
+ArrayView<long long> ConfigParser::LookupIntegerList(const std::string& key) const
+{
+   return LookupIntegerList("", key);
 }
 
-int ConfigParser::LookupInteger(const std::string& key) const
+ArrayView<double> ConfigParser::LookupDoubleList(const std::string& section, const std::string& key) const
 {
-   return LookupInteger("", key);
+   const ListValue& list = FindList(section, key);
+   if(list.reals.size() != list.elements.size())
+   {
+      ConversionError(section, key, "list elements are not all numbers", list.elements.front().lineNum);
+   }
+   return ArrayView<double>(list.reals.empty() ? NULL : &list.reals[0], list.reals.size());
 }
 
-std::string ConfigParser::LookupString(const std::string& section, const std::string& key) const
+ArrayView<double> ConfigParser::LookupDoubleList(const std::string& key) const
 {
-   Token tok = Lookup(section, key); //Throws if not found
-   return tok.lexeme;
+   return LookupDoubleList("", key);
 }
 
-std::string ConfigParser::LookupString(const std::string& key) const
+std::vector<std::string> ConfigParser::LookupStringList(const std::string& section, const std::string& key) const
 {
-   return LookupString("", key);
+   const ListValue& list = FindList(section, key);
+   std::vector<std::string> values;
+   values.reserve(list.elements.size());
+   for(size_t i = 0; i < list.elements.size(); i++)
+   {
+      values.push_back(list.elements[i].lexeme);
+   }
+   return values;
 }
 
+std::vector<std::string> ConfigParser::LookupStringList(const std::string& key) const
+{
+   return LookupStringList("", key);
+}
 
 void ConfigParser::ParseError(const char* expected)
 {
    std::stringstream msgBuf;
    msgBuf << "Syntax error (line " << mCurToken.lineNum << ")\n";
    msgBuf << "Expected: " << expected << " Got: " << mCurToken.lexeme;
-   throw std::runtime_error(msgBuf.str());
+   Diagnostic diagnostic = {mCurToken.lineNum, CurrentTokenColumn(), expected,
+      mCurToken.type == END_OF_FILE ? "end of input" : mCurToken.lexeme};
+   throw SyntaxError(msgBuf.str(), diagnostic);
 }
 
-
-void ConfigParser::ConversionError(std::string section, std::string key, std::string caughtMsg, int sourceLine) const
+//mCurToken is the last token read, so it ends at the read position.
+//Strings are found by their source text, which is only kept while
+//recording.
+int ConfigParser::CurrentTokenColumn()
 {
-   std::stringstream msgBuf;
-   msgBuf << "Conversion error in lookup ";
-   if(!section.empty())
+   if(!mMemoryBuf)
+   {
+      return 0;
+   }
+   size_t length = mCurToken.lexeme.size();
+   if(mCurToken.type == STRING)
    {
-      msgBuf << "\"" << section << "\":";
+      length = (mKeepLayout || mRecover) ? lexer.GetStringSource().size() : length + 2;
    }
-   msgBuf << "\"" << key << "\" (source line " << sourceLine <<")\n";
-   msgBuf << caughtMsg;
-   throw std::logic_error(msgBuf.str());
+   return mMemoryBuf->Column(length);
 }
 
 }
@@ -3,48 +3,239 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <set>
+#include <utility>
+#include <memory>
+#include <future>
+#include <ostream>
 #include "config_lexer.h"
+#include "config_source.h"
+#include "array_view.h"
+#include "name_range.h"
+#include "value_store.h"
+#include "memory_stream.h"
+#include "config_diff.h"
 
 namespace SimpleConfig
 {
 
-class ConfigParser
+//One token of recorded source layout
+typedef struct layoutPiece
+{
+   std::string trivia; //Whitespace and comments before the token
+   std::string text;
+} LayoutPiece;
+
+//Thrown for input that does not parse. The diagnostic holds the parts
+//of the message.
+class SyntaxError : public std::runtime_error
 {
 public:
-   ConfigParser();
-   ~ConfigParser();
+   SyntaxError(const std::string& message, const Diagnostic& diagnostic);
+   virtual ~SyntaxError() throw();
 
-   void Parse(const char *filename);
-   void Parse(const std::string& filename);
-   void Parse(std::istream& configStream);
+   const Diagnostic& GetDiagnostic() const;
 
-   Token Lookup(const std::string& section, const std::string& key) const;
+private:
+   Diagnostic mDiagnostic;
+};
 
-   bool LookupBoolean(const std::string& section, const std::string& key) const;
-   bool LookupBoolean(const std::string& key) const;
+typedef enum bufferOwnership
+{
+   COPY_BUFFER, BORROW_BUFFER
+} BufferOwnership;
 
-   double LookupDouble(const std::string& section, const std::string& key) const;
-   double LookupDouble(const std::string& key) const;
+class ConfigParser : public ConfigSource
+{
+   friend std::vector<ConfigChange> DiffConfigs(const ConfigParser& before, const ConfigParser& after);
+   friend class LayeredConfig;
+   friend class ConfigPushParser;
+   friend class SharedConfig;
+   friend class ParseCache;
+   friend class PersistentConfig;
+   friend class ConfigSchema;
+   friend void WriteEmbeddedConfig(const ConfigParser& config, const std::string& symbol, std::ostream& out);
+   friend void EmitConfig(const ConfigParser& config, std::string& out);
 
-   int LookupInteger(const std::string& section, const std::string& key) const;
-   int LookupInteger(const std::string& key) const;
+public:
+   //section -> key -> index of the value in mValues
+   typedef std::map<std::string, size_t> KeyIndex;
+   typedef std::map<std::string, KeyIndex> SectionIndex;
+   typedef NameRange<SectionIndex> SectionRange;
+   typedef NameRange<KeyIndex> KeyRange;
 
-   std::string LookupString(const std::string& section, const std::string& key) const;
-   std::string LookupString(const std::string& key) const;
+   ConfigParser();
+   ~ConfigParser();
+
+   //gzip (and, when built with HAVE_ZSTD, zstd) compressed files are
+   //recognised by their magic bytes and decompressed while parsing
+   void Parse(const char *filename);
+   void Parse(const std::string& filename);
+   void Parse(std::istream& configStream);
+   //Lexes the buffer in place; data does not need to be null terminated.
+   //With BORROW_BUFFER, long string values point into data instead of
+   //being copied, so data must outlive the parser.
+   void Parse(const char *data, size_t length, BufferOwnership ownership = COPY_BUFFER);
+
+   //Records comments, blank lines and ordering during Parse so that
+   //EmitConfig reproduces the input byte for byte
+   void KeepLayout(bool keep);
+
+   //Lexes on a separate thread while this one parses. Worth it for
+   //large inputs; ignored while recording layout or borrowing a buffer.
+   //Syntax errors of a pipelined parse carry no column (0).
+   void PipelineLexing(bool pipeline);
+
+   //Instead of throwing at the first syntax or lexing error, Parse
+   //records it, resumes at the next line (or at the statement that ended
+   //the broken one) and keeps every value that did parse. Input is read
+   //into memory first so diagnostics can give columns. Errors in
+   //included files and references still throw, and the layout recorded
+   //for a parse with errors is incomplete.
+   void RecoverErrors(bool recover);
+
+   //What the last Parse recovered from, in input order
+   const std::vector<Diagnostic>& Diagnostics() const;
+
+   //Empties the parser so the next Parse starts afresh instead of
+   //merging. Index nodes, value storage and lexer buffers are kept, so
+   //reparsing input of a similar shape allocates nothing unless it
+   //records layout, includes files or has references or dotted sections.
+   void Reset();
+
+   virtual bool Find(const std::string& section, const std::string& key, Token& value) const;
+
+   //Typed lookups read the stored cells directly; the source line is
+   //only fetched when reporting an error
+   using ConfigSource::LookupBoolean;
+   using ConfigSource::LookupDouble;
+   using ConfigSource::LookupInteger;
+   using ConfigSource::LookupString;
+   virtual bool LookupBoolean(const std::string& section, const std::string& key) const;
+   virtual double LookupDouble(const std::string& section, const std::string& key) const;
+   virtual int LookupInteger(const std::string& section, const std::string& key) const;
+   virtual std::string LookupString(const std::string& section, const std::string& key) const;
+
+   //Finds the section once and converts each value straight from its cell
+   virtual size_t LookupBatch(const std::string& section, LookupRequest* requests, size_t count) const;
+
+   //Names in sorted order. Sections are listed once they hold a key, the
+   //unnamed one as "". The keys of a dotted section include the ones it
+   //inherits. Prefix queries take time proportional to the number of
+   //matches. The ranges stay valid until the parser is modified.
+   SectionRange Sections() const;
+   SectionRange Sections(const std::string& prefix) const;
+   KeyRange Keys(const std::string& section) const;
+   KeyRange Keys(const std::string& section, const std::string& prefix) const;
+
+   //List values. Numeric lists are converted once at parse time; the
+   //returned views point into the parser and stay valid until the key
+   //is assigned again.
+   ArrayView<long long> LookupIntegerList(const std::string& section, const std::string& key) const;
+   ArrayView<long long> LookupIntegerList(const std::string& key) const;
+
+   ArrayView<double> LookupDoubleList(const std::string& section, const std::string& key) const;
+   ArrayView<double> LookupDoubleList(const std::string& key) const;
+
+   std::vector<std::string> LookupStringList(const std::string& section, const std::string& key) const;
+   std::vector<std::string> LookupStringList(const std::string& key) const;
 
 private:
-   void ParseSectionHeader(std::istream& configStream);
-   void ParseAssignment(std::istream& configStream);
+   void ParseFileStream(std::istream& file);
+   void ParseTokens(TokenSource& tokens);
+   void ParseRecovering(TokenSource& tokens, std::istream& source);
+   void ParseStatement(TokenSource& tokens);
+   void ParseSectionHeader(TokenSource& tokens);
+   void ParseAssignment(TokenSource& tokens);
+   void ParseList(TokenSource& tokens, const std::string& id);
+   void ParseInclude(const Token& path);
    bool IsLiteral(const Token& tok);
+   std::pair<KeyIndex::iterator, bool> InsertKey(const std::string& key);
+   void StoreValue(const std::string& key, const Token& tok);
+   void StoreList(const std::string& key, ListValue& list, int line);
 
-   void ConversionError(std::string section, std::string key, std::string caughtMsg, int sourceLine) const;
-   void ParseError(const char* expected);
+   const KeyIndex* FindSection(const std::string& section) const;
+   void VisibleSections(std::map<std::string, const KeyIndex*>& sections) const;
+   bool FindIndex(const std::string& section, const std::string& key, size_t& index) const;
+   size_t MemoryUsage() const;
+   const ListValue& FindList(const std::string& section, const std::string& key) const;
 
-   std::map<std::string, std::map<std::string, Token> > parseMap;
+   void ParseError(const char* expected);
+   int CurrentTokenColumn();
+
+   typedef enum resolveState
+   {
+      UNRESOLVED = 0, RESOLVING, RESOLVED
+   } ResolveState;
+
+   void BeginParse();
+   void FinishParse();
+   void MergeIncludes();
+   void BuildInheritance();
+   void ResolveReferences();
+   void ResolveValue(size_t index, const std::string& name, std::map<size_t, ResolveState>& state, std::vector<std::string>& chain);
+
+   SectionIndex parseMap;
+   ValueStore mValues;
+
+   //Index nodes released by Reset, reused before allocating new ones.
+   //Node handles cannot be copied, so a copied parser starts without.
+   typedef struct spareNodes
+   {
+      spareNodes() {}
+      spareNodes(const spareNodes&) {}
+      spareNodes& operator=(const spareNodes&) { return *this; }
+
+      std::vector<SectionIndex::node_type> sections;
+      std::vector<KeyIndex::node_type> keys;
+   } SpareNodes;
+
+   SpareNodes mSpare;
+
+   //Dotted sections ([a.b.c]) seen in headers, and for each dotted
+   //section with a keyed ancestor, its own keys merged over the nearest
+   //ancestors'. Rebuilt when a parse completes.
+   std::set<std::string> mDottedSections;
+   SectionIndex mInherited;
+
+   //Set while parsing a buffer whose strings may be borrowed
+   const MemoryStreamBuf* mBorrowedBuf;
+   const char* mBorrowedData;
+
+   //Set while parsing any buffer without pipelining, for diagnostic columns
+   const MemoryStreamBuf* mMemoryBuf;
+
+   bool mRecover;
+   std::vector<Diagnostic> mDiagnostics;
+
+   bool mKeepLayout;
+   bool mPipelined;
+   std::vector<LayoutPiece> mLayout;
    ConfigLexer lexer;
 
+   //section/key of string values containing references, expanded once the parse completes
+   std::vector<std::pair<std::string, std::string> > mUnresolved;
+
+   //An included file being parsed in the background. Its values are
+   //merged when the parse completes, except for keys this file assigns
+   //after the include.
+   typedef struct pendingInclude
+   {
+      std::string section;   //Receives the included file's unsectioned keys
+      size_t position;       //Number of entries in mAssigned at the include
+      std::shared_future<std::shared_ptr<const ConfigParser> > result;
+   } PendingInclude;
+
+   std::vector<PendingInclude> mIncludes;
+   std::vector<std::pair<std::string, std::string> > mAssigned; //Assignments after the first include
+   std::string mIncludeDir;  //Relative includes are resolved against this
+   std::string mIncludeKey;  //Cache key of the file being parsed, if it is cached
+
    Token mCurToken;
    std::string mCurSection;
+   std::string mCurKey;
+   ListValue mListScratch;
 };
 
 
@@ -1,7 +1,10 @@
 #include "config_parser.h"
+#include "config_diff.h"
 #include "gtest/gtest.h"
 #include <sstream>
 #include <stdexcept>
+#include <cstdlib>
+#include <iterator>
 
 namespace
 {
@@ -18,6 +21,42 @@ TEST(ParseTest, ExistingFile)
    EXPECT_NO_THROW(c.Parse("testFile.txt"));
 }
 
+TEST(ParseTest, BufferParseWorks)
+{
+   const char buffer[] = "a=1\n[S]\nb=\"x\"\nignored past length";
+   SimpleConfig::ConfigParser c;
+   c.Parse(buffer, sizeof("a=1\n[S]\nb=\"x\"\n") - 1);
+   EXPECT_EQ(1, c.LookupInteger("a"));
+   EXPECT_EQ("x", c.LookupString("S", "b"));
+}
+
+TEST(ParseTest, BorrowedBufferParseWorks)
+{
+   const char buffer[] = "long=\"a string longer than one value cell\"\n[S]\nb=2\n";
+   SimpleConfig::ConfigParser c;
+   c.Parse(buffer, sizeof(buffer) - 1, SimpleConfig::BORROW_BUFFER);
+   EXPECT_EQ("a string longer than one value cell", c.LookupString("long"));
+   EXPECT_EQ(2, c.LookupInteger("S", "b"));
+}
+
+//Values read back as written, and a real never reads as an integer
+TEST(ParseTest, LookupStringKeepsSourceText)
+{
+   const char buffer[] = "ratio = 2.0\nfine = 1.10\nmask = 0x10\nmode = 010\nflag = TRUE\n";
+   SimpleConfig::ConfigParser c;
+   c.Parse(buffer, sizeof(buffer) - 1);
+   EXPECT_EQ("2.0", c.LookupString("ratio"));
+   EXPECT_EQ("1.10", c.LookupString("fine"));
+   EXPECT_EQ("0x10", c.LookupString("mask"));
+   EXPECT_EQ("010", c.LookupString("mode"));
+   EXPECT_EQ("TRUE", c.LookupString("flag"));
+   EXPECT_THROW(c.LookupInteger("ratio"), std::logic_error);
+   EXPECT_EQ(2.0, c.LookupDouble("ratio"));
+   EXPECT_EQ(16, c.LookupInteger("mask"));
+   EXPECT_EQ(8, c.LookupInteger("mode"));
+   EXPECT_TRUE(c.LookupBoolean("flag"));
+}
+
 TEST(ParseTest, BadConfigFormat)
 {
    std::string badConfig =
@@ -238,4 +277,518 @@ TEST_F(SectionedConfigParseTest, BadKeyLookupStringThrows)
    EXPECT_THROW(testConfigParser.LookupString("Section2", "testNonExistantKey"), std::logic_error);
 }
 
+
+TEST(ReferenceTest, SectionReferencesExpanded)
+{
+   std::istringstream configStream(
+      "root=\"/srv\"\n"
+      "[Paths]\n"
+      "data=\"${.root}/data\"\n"
+      "logs=\"${Paths.data}/logs\"\n"
+      "[Net]\n"
+      "port=8080\n"
+      "url=\"http://host:${Net.port}\"\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   EXPECT_EQ("/srv/data/logs", c.LookupString("Paths", "logs"));
+   EXPECT_EQ("/srv/data", c.LookupString("Paths", "data"));
+   EXPECT_EQ("http://host:8080", c.LookupString("Net", "url"));
+}
+
+TEST(ReferenceTest, EnvironmentReferencesExpanded)
+{
+   setenv("CONFIG_PARSER_TEST_HOME", "/home/test", 1);
+   std::istringstream configStream("home=\"${CONFIG_PARSER_TEST_HOME}/cfg\"\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   EXPECT_EQ("/home/test/cfg", c.LookupString("home"));
+}
+
+TEST(ReferenceTest, UndefinedReferenceThrows)
+{
+   std::istringstream configStream("a=\"${S.missing}\"\n");
+   SimpleConfig::ConfigParser c;
+   EXPECT_THROW(c.Parse(configStream), std::runtime_error);
+}
+
+//The reference is never expanded, so an undefined one does not matter
+TEST(ReferenceTest, ReassignedKeyIsNotExpanded)
+{
+   std::istringstream configStream(
+      "a=\"${CONFIG_PARSER_TEST_UNDEFINED}\"\n"
+      "a=[1, 2]\n"
+      "b=\"${.c}\"\n"
+      "b=5\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   ASSERT_EQ(2u, c.LookupIntegerList("a").size());
+   EXPECT_EQ(2, c.LookupIntegerList("a")[1]);
+   EXPECT_EQ(5, c.LookupInteger("b"));
+}
+
+TEST(ReferenceTest, CycleReportsLines)
+{
+   std::istringstream configStream(
+      "a=\"${.b}\"\n"
+      "b=\"${.a}\"\n");
+   SimpleConfig::ConfigParser c;
+   try
+   {
+      c.Parse(configStream);
+      FAIL() << "cycle not detected";
+   }
+   catch(std::runtime_error& e)
+   {
+      std::string msg = e.what();
+      EXPECT_NE(std::string::npos, msg.find("line 1"));
+      EXPECT_NE(std::string::npos, msg.find("line 2"));
+   }
+}
+
+
+class ListConfigParseTest : public ::testing::Test
+{
+protected:
+
+   ListConfigParseTest() :
+      goodConfig(
+         "ports = [80, 443, 8080]\n"
+         "weights = [0.5, 1, -2.5e1]\n"
+         "names = [\"a\", \"b c\"]\n"
+         "empty = []\n"
+         "[Section]\n"
+         "ids = [\n"
+         "   0x10,\n"
+         "   -3\n"
+         "]\n"),
+      goodConfigStream(goodConfig)
+   {
+      testConfigParser.Parse(goodConfigStream);
+   }
+
+   std::string goodConfig;
+   std::istringstream goodConfigStream;
+   SimpleConfig::ConfigParser testConfigParser;
+};
+
+TEST_F(ListConfigParseTest, IntegerListWorks)
+{
+   SimpleConfig::ArrayView<long long> ports = testConfigParser.LookupIntegerList("ports");
+   ASSERT_EQ(3u, ports.size());
+   EXPECT_EQ(80, ports[0]);
+   EXPECT_EQ(443, ports[1]);
+   EXPECT_EQ(8080, ports[2]);
+
+   SimpleConfig::ArrayView<long long> ids = testConfigParser.LookupIntegerList("Section", "ids");
+   ASSERT_EQ(2u, ids.size());
+   EXPECT_EQ(16, ids[0]);
+   EXPECT_EQ(-3, ids[1]);
+}
+
+TEST_F(ListConfigParseTest, DoubleListWorks)
+{
+   SimpleConfig::ArrayView<double> weights = testConfigParser.LookupDoubleList("weights");
+   ASSERT_EQ(3u, weights.size());
+   EXPECT_DOUBLE_EQ(0.5, weights[0]);
+   EXPECT_DOUBLE_EQ(1.0, weights[1]);
+   EXPECT_DOUBLE_EQ(-25.0, weights[2]);
+   EXPECT_EQ(3u, testConfigParser.LookupDoubleList("ports").size());
+}
+
+TEST_F(ListConfigParseTest, StringListWorks)
+{
+   std::vector<std::string> names = testConfigParser.LookupStringList("names");
+   ASSERT_EQ(2u, names.size());
+   EXPECT_EQ("a", names[0]);
+   EXPECT_EQ("b c", names[1]);
+   EXPECT_EQ("[\"a\", \"b c\"]", testConfigParser.LookupString("names"));
+}
+
+TEST_F(ListConfigParseTest, EmptyListWorks)
+{
+   EXPECT_TRUE(testConfigParser.LookupIntegerList("empty").empty());
+}
+
+TEST_F(ListConfigParseTest, WrongListTypeThrows)
+{
+   EXPECT_THROW(testConfigParser.LookupIntegerList("weights"), std::logic_error);
+   EXPECT_THROW(testConfigParser.LookupDoubleList("names"), std::logic_error);
+   EXPECT_THROW(testConfigParser.LookupIntegerList("missing"), std::invalid_argument);
+}
+
+TEST(ListParseTest, MissingCommaThrows)
+{
+   std::istringstream badConfStream("a = [1 2]\n");
+   SimpleConfig::ConfigParser c;
+   EXPECT_THROW(c.Parse(badConfStream), std::runtime_error);
+}
+
+TEST(BatchLookupTest, ResolvesAllRequests)
+{
+   std::istringstream configStream("[Net]\nport=8080\nratio=2\nverbose=true\nhost=\"example\"\ncount=\"12\"\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+
+   int port = 0;
+   double ratio = 0;
+   bool verbose = false;
+   std::string host;
+   int count = 0;
+   SimpleConfig::LookupRequest requests[] = {
+      {"port", SimpleConfig::INTEGER_VALUE, &port, SimpleConfig::LOOKUP_MISSING},
+      {"ratio", SimpleConfig::DOUBLE_VALUE, &ratio, SimpleConfig::LOOKUP_MISSING},
+      {"verbose", SimpleConfig::BOOLEAN_VALUE, &verbose, SimpleConfig::LOOKUP_MISSING},
+      {"host", SimpleConfig::STRING_VALUE, &host, SimpleConfig::LOOKUP_MISSING},
+      {"count", SimpleConfig::INTEGER_VALUE, &count, SimpleConfig::LOOKUP_MISSING}
+   };
+
+   EXPECT_EQ(0u, c.LookupBatch("Net", requests, 5));
+   EXPECT_EQ(8080, port);
+   EXPECT_EQ(2.0, ratio);
+   EXPECT_TRUE(verbose);
+   EXPECT_EQ("example", host);
+   EXPECT_EQ(12, count);
+   EXPECT_NO_THROW(c.LookupAll("Net", requests, 5));
+}
+
+TEST(BatchLookupTest, ReportsEveryFailure)
+{
+   std::istringstream configStream("[Net]\nport=8080\nhost=\"example\"\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+
+   int port = 0;
+   int host = 0;
+   bool missing = false;
+   SimpleConfig::LookupRequest requests[] = {
+      {"port", SimpleConfig::INTEGER_VALUE, &port, SimpleConfig::LOOKUP_MISSING},
+      {"host", SimpleConfig::INTEGER_VALUE, &host, SimpleConfig::LOOKUP_OK},
+      {"missing", SimpleConfig::BOOLEAN_VALUE, &missing, SimpleConfig::LOOKUP_OK}
+   };
+
+   EXPECT_EQ(2u, c.LookupBatch("Net", requests, 3));
+   EXPECT_EQ(SimpleConfig::LOOKUP_OK, requests[0].status);
+   EXPECT_EQ(SimpleConfig::LOOKUP_WRONG_TYPE, requests[1].status);
+   EXPECT_EQ(SimpleConfig::LOOKUP_MISSING, requests[2].status);
+   EXPECT_EQ(8080, port);
+
+   try
+   {
+      c.LookupAll("Net", requests, 3);
+      FAIL() << "LookupAll did not throw";
+   }
+   catch(std::invalid_argument& e)
+   {
+      std::string msg = e.what();
+      EXPECT_NE(std::string::npos, msg.find("host"));
+      EXPECT_NE(std::string::npos, msg.find("missing"));
+   }
+
+   EXPECT_EQ(3u, c.LookupBatch("NoSuchSection", requests, 3));
+}
+
+TEST(IterationTest, ListsSectionsAndKeysInOrder)
+{
+   std::istringstream configStream("top=1\n[backend_b]\nport=2\n[backend_a]\nport=1\nhost=\"a\"\n[frontend]\nport=3\n[empty]\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+
+   std::vector<std::string> sections(c.Sections().begin(), c.Sections().end());
+   ASSERT_EQ(4u, sections.size());
+   EXPECT_EQ("", sections[0]);
+   EXPECT_EQ("backend_a", sections[1]);
+   EXPECT_EQ("backend_b", sections[2]);
+   EXPECT_EQ("frontend", sections[3]);
+
+   std::vector<std::string> keys(c.Keys("backend_a").begin(), c.Keys("backend_a").end());
+   ASSERT_EQ(2u, keys.size());
+   EXPECT_EQ("host", keys[0]);
+   EXPECT_EQ("port", keys[1]);
+   EXPECT_TRUE(c.Keys("missing").empty());
+}
+
+TEST(IterationTest, PrefixQueries)
+{
+   std::istringstream configStream("[backend_a]\nport=1\n[backend_b]\nport=2\nproxy=3\nhost=4\n[backend]\nx=1\n[backends]\nx=1\n[zeta]\nx=1\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+
+   std::vector<std::string> backends;
+   SimpleConfig::ConfigParser::SectionRange range = c.Sections("backend_");
+   for(SimpleConfig::ConfigParser::SectionRange::iterator it = range.begin(); it != range.end(); ++it)
+   {
+      backends.push_back(*it);
+   }
+   ASSERT_EQ(2u, backends.size());
+   EXPECT_EQ("backend_a", backends[0]);
+   EXPECT_EQ("backend_b", backends[1]);
+
+   std::vector<std::string> keys(c.Keys("backend_b", "p").begin(), c.Keys("backend_b", "p").end());
+   ASSERT_EQ(2u, keys.size());
+   EXPECT_EQ("port", keys[0]);
+   EXPECT_EQ("proxy", keys[1]);
+
+   EXPECT_TRUE(c.Sections("nothing").empty());
+   EXPECT_TRUE(c.Keys("missing", "p").empty());
+   EXPECT_EQ(5, std::distance(c.Sections("").begin(), c.Sections("").end()));
+}
+
+TEST(InheritanceTest, MissingKeysFallBackToParents)
+{
+   std::istringstream configStream(
+      "[prod]\nport=80\nlog=\"warn\"\n"
+      "[prod.us_east]\nlog=\"info\"\n"
+      "[prod.us_east.web]\nthreads=8\n"
+      "[prod.eu.web]\n"
+      "[dev.web]\nthreads=1\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+
+   EXPECT_EQ(8, c.LookupInteger("prod.us_east.web", "threads"));
+   EXPECT_EQ("info", c.LookupString("prod.us_east.web", "log"));
+   EXPECT_EQ(80, c.LookupInteger("prod.us_east.web", "port"));
+   EXPECT_EQ("warn", c.LookupString("prod.eu.web", "log"));
+   EXPECT_THROW(c.LookupInteger("dev.web", "port"), std::invalid_argument);
+   EXPECT_THROW(c.LookupInteger("prod", "threads"), std::invalid_argument);
+}
+
+TEST(InheritanceTest, KeysIncludeInherited)
+{
+   std::istringstream configStream("[a]\nx=1\n[a.b]\ny=2\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   std::vector<std::string> keys(c.Keys("a.b").begin(), c.Keys("a.b").end());
+   ASSERT_EQ(2u, keys.size());
+   EXPECT_EQ("x", keys[0]);
+   EXPECT_EQ("y", keys[1]);
+   EXPECT_EQ(1, std::distance(c.Keys("a.b", "x").begin(), c.Keys("a.b", "x").end()));
+}
+
+TEST(InheritanceTest, ReferencesAndBatchesSeeInheritedKeys)
+{
+   std::istringstream configStream("[app]\nroot=\"/srv\"\n[app.web]\ndocs=\"${app.web.root}/docs\"\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   EXPECT_EQ("/srv/docs", c.LookupString("app.web", "docs"));
+
+   std::string root;
+   SimpleConfig::LookupRequest request = {"root", SimpleConfig::STRING_VALUE, &root, SimpleConfig::LOOKUP_MISSING};
+   EXPECT_EQ(0u, c.LookupBatch("app.web", &request, 1));
+   EXPECT_EQ("/srv", root);
+}
+
+TEST(InheritanceTest, BadDottedNamesThrow)
+{
+   std::istringstream doubleDot("[a..b]\nx=1\n");
+   std::istringstream trailingDot("[a.]\nx=1\n");
+   std::istringstream dottedKey("[a]\nx.y=1\n");
+   SimpleConfig::ConfigParser c;
+   EXPECT_THROW(c.Parse(doubleDot), std::runtime_error);
+   EXPECT_THROW(c.Parse(trailingDot), std::runtime_error);
+   EXPECT_THROW(c.Parse(dottedKey), std::runtime_error);
+}
+
+std::string GeneratedConfig(int sections, int keys)
+{
+   std::ostringstream out;
+   for(int s = 0; s < sections; s++)
+   {
+      out << "[section" << s << "]\n";
+      for(int k = 0; k < keys; k++)
+      {
+         out << "int" << k << " = " << s * k << "\n";
+         out << "str" << k << " = \"value " << s << " " << k << "\"\n";
+         out << "real" << k << " = " << k << ".5 # comment\n";
+      }
+   }
+   return out.str();
+}
+
+TEST(PipelinedParseTest, MatchesSequentialParse)
+{
+   std::string text = GeneratedConfig(50, 40);
+   std::istringstream sequentialStream(text);
+   std::istringstream pipelinedStream(text);
+
+   SimpleConfig::ConfigParser sequential;
+   SimpleConfig::ConfigParser pipelined;
+   pipelined.PipelineLexing(true);
+   sequential.Parse(sequentialStream);
+   pipelined.Parse(pipelinedStream);
+
+   EXPECT_TRUE(SimpleConfig::DiffConfigs(sequential, pipelined).empty());
+   EXPECT_EQ(49 * 39, pipelined.LookupInteger("section49", "int39"));
+   EXPECT_EQ(6050, pipelined.Lookup("section49", "real39").lineNum);
+}
+
+TEST(PipelinedParseTest, EmptyInputWorks)
+{
+   std::istringstream configStream("");
+   SimpleConfig::ConfigParser c;
+   c.PipelineLexing(true);
+   EXPECT_NO_THROW(c.Parse(configStream));
+}
+
+TEST(PipelinedParseTest, ErrorsStopBothThreads)
+{
+   std::string text = GeneratedConfig(50, 40);
+   std::istringstream syntaxError("a = \n" + text);
+   std::istringstream lexError(text + "b = \"unterminated\n");
+
+   SimpleConfig::ConfigParser c;
+   c.PipelineLexing(true);
+   EXPECT_THROW(c.Parse(syntaxError), std::runtime_error);
+   EXPECT_THROW(c.Parse(lexError), std::logic_error);
+}
+
+
+TEST(ResetTest, ReparseReplacesContents)
+{
+   std::string first = "[old]\nkey = 1\nlist = [\"a\", \"b\", \"c\"]\n[shared]\nname = \"a long string value, not inline\"\n";
+   std::string second = "[shared]\nlist = [1, 2]\n[new]\nkey = 2\n";
+   SimpleConfig::ConfigParser c;
+   c.Parse(first.data(), first.size());
+   c.Reset();
+   EXPECT_TRUE(c.Sections().begin() == c.Sections().end());
+   EXPECT_THROW(c.Lookup("old", "key"), std::invalid_argument);
+
+   c.Parse(second.data(), second.size());
+   EXPECT_THROW(c.Lookup("old", "key"), std::invalid_argument);
+   EXPECT_THROW(c.Lookup("shared", "name"), std::invalid_argument);
+   EXPECT_EQ(2, c.LookupInteger("new", "key"));
+   SimpleConfig::ArrayView<long long> list = c.LookupIntegerList("shared", "list");
+   ASSERT_EQ(2u, list.size());
+   EXPECT_EQ(2, list[1]);
+   EXPECT_EQ("[1, 2]", c.LookupString("shared", "list"));
+
+   c.Reset();
+   c.Parse(first.data(), first.size());
+   EXPECT_EQ("a long string value, not inline", c.LookupString("shared", "name"));
+   std::vector<std::string> strings = c.LookupStringList("old", "list");
+   ASSERT_EQ(3u, strings.size());
+   EXPECT_EQ("c", strings[2]);
+   EXPECT_THROW(c.LookupIntegerList("old", "list"), std::logic_error);
+}
+
+TEST(ResetTest, LineNumbersRestartWithEachParse)
+{
+   std::string text = "a = 1\n\nb = 2\n";
+   SimpleConfig::ConfigParser c;
+   c.Parse(text.data(), text.size());
+   c.Parse(text.data(), text.size());
+   EXPECT_EQ(3, c.Lookup("", "b").lineNum);
+
+   c.Reset();
+   std::istringstream configStream(text);
+   c.Parse(configStream);
+   EXPECT_EQ(3, c.Lookup("", "b").lineNum);
+}
+
+TEST(ResetTest, CopiesOfResetParserWork)
+{
+   std::string text = GeneratedConfig(3, 4);
+   SimpleConfig::ConfigParser c;
+   c.Parse(text.data(), text.size());
+   c.Reset();
+   SimpleConfig::ConfigParser copy(c);
+   copy.Parse(text.data(), text.size());
+   c.Parse(text.data(), text.size());
+   EXPECT_TRUE(SimpleConfig::DiffConfigs(c, copy).empty());
+}
+
+
+void ExpectDiagnostic(const SimpleConfig::Diagnostic& d, int line, int column, const std::string& expected, const std::string& got)
+{
+   EXPECT_EQ(line, d.line);
+   EXPECT_EQ(column, d.column);
+   EXPECT_EQ(expected, d.expected);
+   EXPECT_EQ(got, d.got);
+}
+
+TEST(RecoveryTest, EveryErrorCollectedInOnePass)
+{
+   std::istringstream configStream(
+      "[a]\n"
+      "x = 1\n"
+      "y 2\n"
+      "z = 3\n"
+      "w = $\n"
+      "v = 5\n"
+      "[b\n"
+      "u = 6\n"
+      "t =\n"
+      "s = \"seven\"\n"
+      "r = [1, \"two\" 3]\n");
+   SimpleConfig::ConfigParser c;
+   c.RecoverErrors(true);
+   EXPECT_NO_THROW(c.Parse(configStream));
+
+   const std::vector<SimpleConfig::Diagnostic>& diagnostics = c.Diagnostics();
+   ASSERT_EQ(5u, diagnostics.size());
+   ExpectDiagnostic(diagnostics[0], 3, 3, "'=' after identifier", "2");
+   ExpectDiagnostic(diagnostics[1], 5, 5, "token", "$");
+   ExpectDiagnostic(diagnostics[2], 8, 1, "']' in section header", "u");
+   ExpectDiagnostic(diagnostics[3], 10, 1, "literal after '='", "s");
+   ExpectDiagnostic(diagnostics[4], 11, 15, "',' or ']' in list", "3");
+
+   EXPECT_EQ(1, c.LookupInteger("a", "x"));
+   EXPECT_EQ(3, c.LookupInteger("a", "z"));
+   EXPECT_EQ(5, c.LookupInteger("a", "v"));
+   EXPECT_EQ(6, c.LookupInteger("b", "u"));
+   EXPECT_EQ("seven", c.LookupString("b", "s"));
+   EXPECT_THROW(c.Lookup("a", "y"), std::invalid_argument);
+   EXPECT_THROW(c.Lookup("a", "w"), std::invalid_argument);
+   EXPECT_THROW(c.Lookup("b", "r"), std::invalid_argument);
+}
+
+TEST(RecoveryTest, StringErrorsAndCleanInput)
+{
+   std::string text = "a = \"bad \\q escape\"\nb = 2\nc = \"unterminated\n";
+   SimpleConfig::ConfigParser c;
+   c.RecoverErrors(true);
+   c.Parse(text.data(), text.size());
+   ASSERT_EQ(2u, c.Diagnostics().size());
+   ExpectDiagnostic(c.Diagnostics()[0], 1, 11, "escape sequence", "\\q");
+   ExpectDiagnostic(c.Diagnostics()[1], 3, 0, "'\"' closing the string", "end of input");
+   EXPECT_EQ(2, c.LookupInteger("b"));
+
+   std::string clean = "[s]\nk = \"v\"\n";
+   c.Parse(clean.data(), clean.size());
+   EXPECT_TRUE(c.Diagnostics().empty());
+   EXPECT_EQ("v", c.LookupString("s", "k"));
+}
+
+TEST(RecoveryTest, ErrorsCarryDiagnosticsWithoutRecovery)
+{
+   std::string text = "a = 1\n  b = ]\n";
+   SimpleConfig::ConfigParser c;
+   try
+   {
+      c.Parse(text.data(), text.size());
+      FAIL() << "no exception";
+   }
+   catch(SimpleConfig::SyntaxError& e)
+   {
+      ExpectDiagnostic(e.GetDiagnostic(), 2, 7, "literal after '='", "]");
+   }
+   EXPECT_TRUE(c.Diagnostics().empty());
+}
+
+//The buffer position is the lexer thread's, not the parser's
+TEST(RecoveryTest, PipelinedErrorsHaveNoColumn)
+{
+   std::string text = "a = 1\n  b = ]\n" + GeneratedConfig(20, 20);
+   SimpleConfig::ConfigParser c;
+   c.PipelineLexing(true);
+   try
+   {
+      c.Parse(text.data(), text.size());
+      FAIL() << "no exception";
+   }
+   catch(SimpleConfig::SyntaxError& e)
+   {
+      ExpectDiagnostic(e.GetDiagnostic(), 2, 0, "literal after '='", "]");
+   }
+}
+
 }
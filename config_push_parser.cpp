@@ -0,0 +1,168 @@
+#include "config_push_parser.h"
+#include "memory_stream.h"
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+
+namespace SimpleConfig
+{
+
+//Thrown when a statement runs past the tokens received so far
+struct NeedMoreTokens {};
+
+class QueuedTokenSource : public TokenSource
+{
+public:
+   explicit QueuedTokenSource(const std::vector<Token>& tokens): mTokens(tokens), mPos(0) {}
+
+   virtual void Next(Token& tok)
+   {
+      if(mPos == mTokens.size())
+      {
+         throw NeedMoreTokens();
+      }
+      tok = mTokens[mPos++];
+   }
+
+   size_t Position() const { return mPos; }
+
+private:
+   const std::vector<Token>& mTokens;
+   size_t mPos;
+};
+
+
+ConfigPushParser::ConfigPushParser(ConfigParser& target):
+   mTarget(target), mChecked(0), mFinished(false)
+{
+   mTarget.BeginParse();
+}
+
+ConfigPushParser::~ConfigPushParser()
+{}
+
+void ConfigPushParser::Feed(const std::string& data)
+{
+   Feed(data.data(), data.size());
+}
+
+void ConfigPushParser::Feed(const char* data, size_t length)
+{
+   if(mFinished)
+   {
+      throw std::logic_error("Feed called after Finish");
+   }
+   //Only a string can continue past a newline, so lexing at newlines
+   //keeps a token split over many chunks from being lexed once per chunk
+   mPending.append(data, length);
+   if(std::memchr(data, '\n', length) != NULL)
+   {
+      LexPending(false);
+      ParsePending();
+   }
+}
+
+void ConfigPushParser::Finish()
+{
+   if(mFinished)
+   {
+      return;
+   }
+   mFinished = true;
+   LexPending(true);
+   ParsePending();
+   mTarget.FinishParse();
+}
+
+//Moves every complete token out of mPending. Unless this is the final
+//call, a token that touches the end of the buffer might continue in the
+//next chunk, so it is left (with the lexer's line count) to be lexed again.
+void ConfigPushParser::LexPending(bool final)
+{
+   MemoryStreamBuf buf(mPending.data(), mPending.size());
+   std::istream source(&buf);
+   size_t consumed = 0;
+
+   while(true)
+   {
+      int line = mLexer.GetLine();
+      Token tok;
+      try
+      {
+         tok = mLexer.GetNextToken(source);
+      }
+      catch(std::logic_error&)
+      {
+         //An unterminated string is only an error once the input has ended
+         if(final || !(source.eof() || source.fail()))
+         {
+            throw;
+         }
+         mLexer.SetLine(line);
+         break;
+      }
+
+      if(!final && (tok.type == END_OF_FILE || source.eof() || source.fail()))
+      {
+         mLexer.SetLine(line);
+         break;
+      }
+
+      mTokens.push_back(tok);
+      consumed = buf.Position();
+      if(tok.type == END_OF_FILE)
+      {
+         consumed = mPending.size();
+         break;
+      }
+   }
+
+   mPending.erase(0, consumed);
+}
+
+//Applies every complete statement in mTokens to the target. mTokens
+//starts at a statement. An unfinished list cannot end before its ']'
+//arrives, so it is not parsed again until then; other statements are a
+//few tokens long and cheap to retry.
+void ConfigPushParser::ParsePending()
+{
+   if(mTokens.size() >= 3 && mTokens[0].type == IDENTIFIER && mTokens[1].type == EQUALS && mTokens[2].type == LEFT_BRACKET)
+   {
+      bool ended = false;
+      for(size_t i = mChecked; i < mTokens.size() && !ended; i++)
+      {
+         ended = (mTokens[i].type == RIGHT_BRACKET || mTokens[i].type == END_OF_FILE);
+      }
+      mChecked = mTokens.size();
+      if(!ended)
+      {
+         return;
+      }
+   }
+
+   QueuedTokenSource tokens(mTokens);
+   size_t parsed = 0;
+
+   try
+   {
+      while(true)
+      {
+         tokens.Next(mTarget.mCurToken);
+         if(mTarget.mCurToken.type == END_OF_FILE)
+         {
+            parsed = tokens.Position();
+            break;
+         }
+         mTarget.ParseStatement(tokens);
+         parsed = tokens.Position();
+      }
+   }
+   catch(NeedMoreTokens&)
+   {
+   }
+
+   mTokens.erase(mTokens.begin(), mTokens.begin() + parsed);
+   mChecked = mTokens.size();
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef CONFIG_PUSH_PARSER_H
+#define CONFIG_PUSH_PARSER_H
+
+#include <string>
+#include <vector>
+#include "config_lexer.h"
+#include "config_parser.h"
+
+namespace SimpleConfig
+{
+
+//Resumable parser for input that arrives in chunks (pipes, sockets).
+//Chunks may split tokens and statements anywhere; the unfinished tail is
+//kept until more input arrives. Input is lexed when a chunk completes a
+//line, and complete statements are applied to the target parser then.
+//Finish() completes the parse the same way the end of the stream does
+//for ConfigParser::Parse. Feeding input of any length in any chunks
+//takes time linear in its size, bar strings spanning many lines.
+class ConfigPushParser
+{
+public:
+   explicit ConfigPushParser(ConfigParser& target);
+   ~ConfigPushParser();
+
+   void Feed(const char* data, size_t length);
+   void Feed(const std::string& data);
+   void Finish();
+
+private:
+   ConfigPushParser(const ConfigPushParser&);
+   ConfigPushParser& operator=(const ConfigPushParser&);
+
+   void LexPending(bool final);
+   void ParsePending();
+
+   ConfigParser& mTarget;
+   ConfigLexer mLexer;
+   std::string mPending;        //Bytes not yet lexed into complete tokens
+   std::vector<Token> mTokens;  //Tokens not yet part of a complete statement
+   size_t mChecked;             //Leading tokens of mTokens known not to end a list
+   bool mFinished;
+};
+
+}
+
+#endif /* CONFIG_PUSH_PARSER_H */
@@ -0,0 +1,105 @@
+#include "config_push_parser.h"
+#include "config_diff.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+const std::string testConfig =
+   "testInt=1234\n"
+   "testDouble = -2.5e3 # comment\n"
+   "testString=\"Hello\n World\"\n"
+   "[Section1]\n"
+   "testBool=true\n"
+   "testList = [80, 443,\n 8080]\n"
+   "[Section2]\n"
+   "testRef=\"${Section1.testBool}!\"\n";
+
+TEST(PushParseTest, EveryChunkSizeMatchesStreamParse)
+{
+   std::istringstream configStream(testConfig);
+   SimpleConfig::ConfigParser expected;
+   expected.Parse(configStream);
+
+   for(size_t chunk = 1; chunk <= testConfig.size(); chunk++)
+   {
+      SimpleConfig::ConfigParser c;
+      SimpleConfig::ConfigPushParser p(c);
+      for(size_t pos = 0; pos < testConfig.size(); pos += chunk)
+      {
+         p.Feed(testConfig.substr(pos, chunk));
+      }
+      p.Finish();
+      EXPECT_TRUE(SimpleConfig::DiffConfigs(expected, c).empty()) << "chunk size " << chunk;
+   }
+}
+
+TEST(PushParseTest, StatementsAppliedBeforeFinish)
+{
+   SimpleConfig::ConfigParser c;
+   SimpleConfig::ConfigPushParser p(c);
+   p.Feed("a=1\nb=2");
+   EXPECT_EQ(1, c.LookupInteger("a"));
+   EXPECT_THROW(c.LookupInteger("b"), std::invalid_argument);
+   p.Feed("3\n");
+   EXPECT_EQ(23, c.LookupInteger("b"));
+   p.Finish();
+}
+
+TEST(PushParseTest, LineNumbersSurviveChunkBoundaries)
+{
+   SimpleConfig::ConfigParser c;
+   SimpleConfig::ConfigPushParser p(c);
+   p.Feed("\n\na=\"x");
+   p.Feed("y\"\nb");
+   p.Feed("=5\n");
+   p.Finish();
+   EXPECT_EQ(3, c.Lookup("", "a").lineNum);
+   EXPECT_EQ(4, c.Lookup("", "b").lineNum);
+}
+
+TEST(PushParseTest, UnterminatedStringThrowsAtFinish)
+{
+   SimpleConfig::ConfigParser c;
+   SimpleConfig::ConfigPushParser p(c);
+   EXPECT_NO_THROW(p.Feed("a=\"abc"));
+   EXPECT_THROW(p.Finish(), std::logic_error);
+}
+
+TEST(PushParseTest, IncompleteStatementThrowsAtFinish)
+{
+   SimpleConfig::ConfigParser c;
+   SimpleConfig::ConfigPushParser p(c);
+   EXPECT_NO_THROW(p.Feed("a="));
+   EXPECT_THROW(p.Finish(), std::runtime_error);
+}
+
+//Each chunk used to relex the unfinished token and reparse the
+//unfinished statement from its start, which made these quadratic
+TEST(PushParseTest, LongValuesInSmallChunks)
+{
+   const int count = 20000;
+   std::ostringstream text;
+   text << "list = [\n";
+   for(int i = 0; i < count; i++)
+   {
+      text << i << ",\n";
+   }
+   text << "-1]\nlong = \"" << std::string(200000, 'x') << "\"\n";
+   std::string input = text.str();
+
+   SimpleConfig::ConfigParser c;
+   SimpleConfig::ConfigPushParser p(c);
+   for(size_t pos = 0; pos < input.size(); pos += 3)
+   {
+      p.Feed(input.substr(pos, 3));
+   }
+   p.Finish();
+   ASSERT_EQ(static_cast<size_t>(count + 1), c.LookupIntegerList("list").size());
+   EXPECT_EQ(count - 1, c.LookupIntegerList("list")[count - 1]);
+   EXPECT_EQ(200000u, c.LookupString("long").size());
+}
+
+}
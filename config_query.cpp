@@ -0,0 +1,158 @@
+#include "config_query.h"
+#include "parse_utilities.h"
+#include <cctype>
+#include <stdexcept>
+
+namespace SimpleConfig
+{
+
+void SplitQuery(const std::string& query, std::string& section, std::string& key)
+{
+   std::string::size_type dot = query.rfind('.');
+   if(dot == std::string::npos)
+   {
+      section.clear();
+      key = query;
+      return;
+   }
+   section.assign(query, 0, dot);
+   key.assign(query, dot + 1, std::string::npos);
+}
+
+std::string EnvName(const std::string& prefix, const std::string& section, const std::string& key)
+{
+   std::string name = section.empty() ? key : section + "_" + key;
+   for(size_t i = 0; i < name.size(); i++)
+   {
+      unsigned char c = name[i];
+      name[i] = std::isalnum(c) ? static_cast<char>(std::toupper(c)) : '_';
+   }
+   return prefix + name;
+}
+
+std::string ShellQuote(const std::string& text)
+{
+   std::string quoted = "'";
+   for(size_t i = 0; i < text.size(); i++)
+   {
+      if(text[i] == '\'')
+      {
+         quoted += "'\\''";
+      }
+      else
+      {
+         quoted += text[i];
+      }
+   }
+   return quoted + "'";
+}
+
+std::string LineEscape(const std::string& text)
+{
+   std::string escaped;
+   escaped.reserve(text.size());
+   for(size_t i = 0; i < text.size(); i++)
+   {
+      switch(text[i])
+      {
+      case '\n':
+         escaped += "\\n";
+         break;
+      case '\r':
+         escaped += "\\r";
+         break;
+      case '\\':
+         escaped += "\\\\";
+         break;
+      default:
+         escaped += text[i];
+         break;
+      }
+   }
+   return escaped;
+}
+
+static const char* TypeName(TokenType type)
+{
+   switch(type)
+   {
+   case INTEGER:
+      return "integer";
+   case REAL_NUMBER:
+      return "real";
+   case BOOL:
+      return "bool";
+   case LIST:
+      return "list";
+   default:
+      return "string";
+   }
+}
+
+//The value in canonical form. Numbers too large to convert keep their text.
+static std::string ValueText(const Token& value)
+{
+   switch(value.type)
+   {
+   case INTEGER:
+      try
+      {
+         return LongLong2Str(Str2LongLong(value.lexeme));
+      }
+      catch(std::logic_error&)
+      {
+         return value.lexeme;
+      }
+   case BOOL:
+      return Str2Bool(value.lexeme) ? "true" : "false";
+   default:
+      return value.lexeme;
+   }
+}
+
+size_t RunQueries(const ConfigSource& config, const std::vector<std::string>& queries, QueryFormat format,
+   const std::string& envPrefix, std::ostream& out, std::ostream& errors)
+{
+   size_t misses = 0;
+   std::string section;
+   std::string key;
+   Token value;
+   for(size_t i = 0; i < queries.size(); i++)
+   {
+      SplitQuery(queries[i], section, key);
+      if(key.empty() || !config.Find(section, key, value))
+      {
+         errors << queries[i] << ": not found" << std::endl;
+         misses++;
+         //Keeps later values on their query's line; env lines carry
+         //their own names
+         if(format == TYPED_FORMAT)
+         {
+            out << queries[i] << "\tmissing\t\n";
+         }
+         else if(format == PLAIN_FORMAT)
+         {
+            out << '\n';
+         }
+         continue;
+      }
+
+      std::string text = ValueText(value);
+      switch(format)
+      {
+      case TYPED_FORMAT:
+         out << queries[i] << '\t' << TypeName(value.type) << '\t' << LineEscape(text) << '\n';
+         break;
+      case ENV_FORMAT:
+         out << EnvName(envPrefix, section, key) << '=' << ShellQuote(text) << '\n';
+         break;
+      default:
+         out << LineEscape(text) << '\n';
+         break;
+      }
+   }
+   out.flush();
+   return misses;
+}
+
+}
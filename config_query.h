@@ -0,0 +1,46 @@
+#ifndef CONFIG_QUERY_H
+#define CONFIG_QUERY_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "config_source.h"
+
+namespace SimpleConfig
+{
+
+typedef enum queryFormat
+{
+   PLAIN_FORMAT, //The value alone
+   TYPED_FORMAT, //query, type and value, tab separated
+   ENV_FORMAT    //SECTION_KEY='value', for eval in a shell
+} QueryFormat;
+
+//Splits "section.key" at its last '.', since section names may be dotted
+//and key names may not. Without a '.', the key is in the unnamed section.
+void SplitQuery(const std::string& query, std::string& section, std::string& key);
+
+//Shell variable name for section.key: upper cased, with every character
+//that is not a letter, digit or '_' replaced by '_', after prefix
+std::string EnvName(const std::string& prefix, const std::string& section, const std::string& key);
+
+//text in single quotes, safe to pass to eval
+std::string ShellQuote(const std::string& text);
+
+//text with newlines, carriage returns and backslashes written as \n,
+//\r and \\, so it fits on one line
+std::string LineEscape(const std::string& text);
+
+//Answers each "section.key" query from config, writing a line per value
+//found to out and a message per miss to errors. Integers are written in
+//decimal and booleans as true or false. Strings are line escaped in the
+//plain and typed formats and shell quoted in the env format, so every
+//value takes one line. The plain and typed formats also write a line per
+//miss, empty or "query<TAB>missing<TAB>", so line n answers query n; the
+//env format writes none. Returns the number of misses.
+size_t RunQueries(const ConfigSource& config, const std::vector<std::string>& queries, QueryFormat format,
+   const std::string& envPrefix, std::ostream& out, std::ostream& errors);
+
+}
+
+#endif /* CONFIG_QUERY_H */
@@ -0,0 +1,125 @@
+#include "config_query.h"
+#include "config_parser.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class ConfigQueryTest : public ::testing::Test
+{
+protected:
+
+   ConfigQueryTest()
+   {
+      std::istringstream configStream(
+         "top = 1\n"
+         "[server]\n"
+         "port = 0x1F90\n"
+         "ratio = 0.75\n"
+         "debug = TRUE\n"
+         "name = \"it's here\"\n"
+         "hosts = [\"a\", \"b\"]\n"
+         "[server.tls]\n"
+         "cert_file = \"/etc/cert\"\n");
+      config.Parse(configStream);
+   }
+
+   size_t Run(const std::string& queries, SimpleConfig::QueryFormat format)
+   {
+      std::vector<std::string> list;
+      std::istringstream lines(queries);
+      std::string line;
+      while(std::getline(lines, line))
+      {
+         list.push_back(line);
+      }
+      out.str("");
+      errors.str("");
+      return SimpleConfig::RunQueries(config, list, format, "APP_", out, errors);
+   }
+
+   SimpleConfig::ConfigParser config;
+   std::ostringstream out;
+   std::ostringstream errors;
+};
+
+TEST(SplitQueryTest, SplitsAtLastDot)
+{
+   std::string section;
+   std::string key;
+   SimpleConfig::SplitQuery("a.b.c", section, key);
+   EXPECT_EQ("a.b", section);
+   EXPECT_EQ("c", key);
+   SimpleConfig::SplitQuery("plain", section, key);
+   EXPECT_EQ("", section);
+   EXPECT_EQ("plain", key);
+}
+
+TEST(ShellQuoteTest, QuotesAreEscaped)
+{
+   EXPECT_EQ("'it'\\''s'", SimpleConfig::ShellQuote("it's"));
+   EXPECT_EQ("''", SimpleConfig::ShellQuote(""));
+   EXPECT_EQ("SERVER_TLS_CERT_FILE", SimpleConfig::EnvName("", "server.tls", "cert-file"));
+}
+
+TEST_F(ConfigQueryTest, PlainValuesInQueryOrder)
+{
+   EXPECT_EQ(0u, Run("server.port\nserver.debug\ntop\nserver.hosts\nserver.ratio", SimpleConfig::PLAIN_FORMAT));
+   EXPECT_EQ("8080\ntrue\n1\n[\"a\", \"b\"]\n0.75\n", out.str());
+   EXPECT_EQ("", errors.str());
+}
+
+TEST_F(ConfigQueryTest, TypedValues)
+{
+   EXPECT_EQ(0u, Run("server.port\nserver.name\nserver.hosts\nserver.tls.port", SimpleConfig::TYPED_FORMAT));
+   EXPECT_EQ("server.port\tinteger\t8080\n"
+      "server.name\tstring\tit's here\n"
+      "server.hosts\tlist\t[\"a\", \"b\"]\n"
+      "server.tls.port\tinteger\t8080\n", out.str());
+}
+
+//Scripts read one line per query
+TEST_F(ConfigQueryTest, MultiLineStringsStayOnOneLine)
+{
+   std::istringstream configStream("motd = \"two\nlines\\r\\\\end\"\n");
+   config.Parse(configStream);
+   EXPECT_EQ(0u, Run("motd\nmotd", SimpleConfig::PLAIN_FORMAT));
+   EXPECT_EQ("two\\nlines\\r\\\\end\ntwo\\nlines\\r\\\\end\n", out.str());
+   EXPECT_EQ(0u, Run("motd", SimpleConfig::TYPED_FORMAT));
+   EXPECT_EQ("motd\tstring\ttwo\\nlines\\r\\\\end\n", out.str());
+   EXPECT_EQ(0u, Run("motd", SimpleConfig::ENV_FORMAT));
+   EXPECT_EQ("APP_MOTD='two\nlines\r\\end'\n", out.str());
+}
+
+TEST_F(ConfigQueryTest, EnvValuesCanBeEvaluated)
+{
+   EXPECT_EQ(0u, Run("server.name\nserver.tls.cert_file\ntop", SimpleConfig::ENV_FORMAT));
+   EXPECT_EQ("APP_SERVER_NAME='it'\\''s here'\n"
+      "APP_SERVER_TLS_CERT_FILE='/etc/cert'\n"
+      "APP_TOP='1'\n", out.str());
+}
+
+TEST_F(ConfigQueryTest, MissesAreCountedAndReported)
+{
+   EXPECT_EQ(3u, Run("server.port\nserver.missing\nnowhere.port\nserver.", SimpleConfig::PLAIN_FORMAT));
+   EXPECT_EQ("8080\n\n\n\n", out.str());
+   EXPECT_EQ("server.missing: not found\nnowhere.port: not found\nserver.: not found\n", errors.str());
+}
+
+//A script reading values by line number must not see later values shift
+TEST_F(ConfigQueryTest, MissesKeepTheirLine)
+{
+   EXPECT_EQ(1u, Run("server.port\nserver.missing\ntop", SimpleConfig::PLAIN_FORMAT));
+   EXPECT_EQ("8080\n\n1\n", out.str());
+
+   EXPECT_EQ(1u, Run("server.port\nserver.missing\ntop", SimpleConfig::TYPED_FORMAT));
+   EXPECT_EQ("server.port\tinteger\t8080\nserver.missing\tmissing\t\ntop\tinteger\t1\n", out.str());
+
+   EXPECT_EQ(1u, Run("server.port\nserver.missing\ntop", SimpleConfig::ENV_FORMAT));
+   EXPECT_EQ("APP_SERVER_PORT='8080'\nAPP_TOP='1'\n", out.str());
+}
+
+}
@@ -0,0 +1,350 @@
+#include "config_schema.h"
+#include "config_query.h"
+#include "parse_utilities.h"
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace SimpleConfig
+{
+
+static SchemaType ParseSchemaType(const std::string& entry, const std::string& name)
+{
+   const char* names[] = {"any", "integer", "real", "bool", "string", "list"};
+   for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+   {
+      if(name == names[i])
+      {
+         return static_cast<SchemaType>(i);
+      }
+   }
+   throw std::invalid_argument("Schema entry " + entry + " has unknown type " + name);
+}
+
+static const char* TypeName(SchemaType type)
+{
+   const char* names[] = {"any", "integer", "real", "bool", "string", "list"};
+   return names[type];
+}
+
+static void AddViolation(std::vector<SchemaViolation>& violations, const std::string& section, const std::string& key,
+   int line, const std::string& message)
+{
+   SchemaViolation violation;
+   violation.section = section;
+   violation.key = key;
+   violation.line = line;
+   violation.message = message;
+   violations.push_back(violation);
+}
+
+
+ConfigSchema::ConfigSchema(const ConfigParser& schema)
+{
+   Compile(schema);
+}
+
+ConfigSchema::ConfigSchema(const std::string& filename)
+{
+   ConfigParser schema;
+   schema.Parse(filename);
+   Compile(schema);
+}
+
+//Reads the schema's own keys only: an entry such as [server.port] must
+//not inherit the fields of an entry [server]
+void ConfigSchema::Compile(const ConfigParser& schema)
+{
+   for(std::set<std::string>::const_iterator it = schema.mDottedSections.begin(); it != schema.mDottedSections.end(); ++it)
+   {
+      if(schema.parseMap.find(*it) == schema.parseMap.end())
+      {
+         throw std::invalid_argument("Schema entry " + *it + " has no type");
+      }
+   }
+
+   //Both levels sorted as the config's index is
+   std::map<std::string, std::map<std::string, KeyRule> > rules;
+   for(ConfigParser::SectionIndex::const_iterator entryIt = schema.parseMap.begin(); entryIt != schema.parseMap.end(); ++entryIt)
+   {
+      const std::string& entry = entryIt->first;
+      const ConfigParser::KeyIndex& fields = entryIt->second;
+      if(entry.empty())
+      {
+         throw std::invalid_argument("Schema fields must be in an entry section");
+      }
+      if(fields.find("type") == fields.end())
+      {
+         throw std::invalid_argument("Schema entry " + entry + " has no type");
+      }
+
+      KeyRule rule;
+      rule.type = ANY_TYPE;
+      rule.required = false;
+      rule.hasMin = false;
+      rule.hasMax = false;
+      rule.min = 0;
+      rule.max = 0;
+      for(ConfigParser::KeyIndex::const_iterator fieldIt = fields.begin(); fieldIt != fields.end(); ++fieldIt)
+      {
+         const std::string& field = fieldIt->first;
+         if(field == "type")
+         {
+            rule.type = ParseSchemaType(entry, schema.LookupString(entry, field));
+         }
+         else if(field == "required")
+         {
+            rule.required = schema.LookupBoolean(entry, field);
+         }
+         else if(field == "min")
+         {
+            rule.hasMin = true;
+            rule.min = schema.LookupDouble(entry, field);
+         }
+         else if(field == "max")
+         {
+            rule.hasMax = true;
+            rule.max = schema.LookupDouble(entry, field);
+         }
+         else if(field == "values")
+         {
+            rule.values = schema.LookupStringList(entry, field);
+         }
+         else
+         {
+            throw std::invalid_argument("Schema entry " + entry + " has unknown field " + field);
+         }
+      }
+
+      std::string section;
+      SplitQuery(entry, section, rule.name);
+      rules[section][rule.name] = rule;
+   }
+
+   mSections.clear();
+   for(std::map<std::string, std::map<std::string, KeyRule> >::const_iterator sectionIt = rules.begin(); sectionIt != rules.end(); ++sectionIt)
+   {
+      SectionRule section;
+      section.name = sectionIt->first;
+      for(std::map<std::string, KeyRule>::const_iterator keyIt = sectionIt->second.begin(); keyIt != sectionIt->second.end(); ++keyIt)
+      {
+         section.keys.push_back(keyIt->second);
+      }
+      mSections.push_back(section);
+   }
+}
+
+//Merges the config's sorted sections with the schema's. Only sections
+//that are absent or lack a required key need a second look, at the keys
+//they inherit.
+std::vector<SchemaViolation> ConfigSchema::Validate(const ConfigParser& config) const
+{
+   std::vector<SchemaViolation> violations;
+   ConfigParser::SectionIndex::const_iterator sectionIt = config.parseMap.begin();
+   size_t ruleIndex = 0;
+   while(sectionIt != config.parseMap.end() || ruleIndex < mSections.size())
+   {
+      int order;
+      if(sectionIt == config.parseMap.end())
+      {
+         order = 1;
+      }
+      else if(ruleIndex == mSections.size())
+      {
+         order = -1;
+      }
+      else
+      {
+         order = sectionIt->first.compare(mSections[ruleIndex].name);
+      }
+
+      if(order < 0)
+      {
+         CheckSection(config, sectionIt->first, &sectionIt->second, NULL, violations);
+         ++sectionIt;
+      }
+      else if(order > 0)
+      {
+         CheckSection(config, mSections[ruleIndex].name, NULL, &mSections[ruleIndex], violations);
+         ruleIndex++;
+      }
+      else
+      {
+         CheckSection(config, sectionIt->first, &sectionIt->second, &mSections[ruleIndex], violations);
+         ++sectionIt;
+         ruleIndex++;
+      }
+   }
+   return violations;
+}
+
+//keys are the section's own keys, or NULL if it has none; rule is NULL
+//for a section the schema does not name
+void ConfigSchema::CheckSection(const ConfigParser& config, const std::string& section, const ConfigParser::KeyIndex* keys,
+   const SectionRule* rule, std::vector<SchemaViolation>& violations) const
+{
+   if(rule == NULL)
+   {
+      int line = 0;
+      for(ConfigParser::KeyIndex::const_iterator keyIt = keys->begin(); keyIt != keys->end(); ++keyIt)
+      {
+         int keyLine = config.mValues.Line(keyIt->second);
+         if(line == 0 || keyLine < line)
+         {
+            line = keyLine;
+         }
+      }
+      AddViolation(violations, section, "", line, "unknown section");
+      return;
+   }
+
+   const ConfigParser::KeyIndex* inherited = NULL;
+   bool inheritedFound = false;
+   ConfigParser::KeyIndex::const_iterator keyIt;
+   if(keys != NULL)
+   {
+      keyIt = keys->begin();
+   }
+   size_t ruleIndex = 0;
+   while((keys != NULL && keyIt != keys->end()) || ruleIndex < rule->keys.size())
+   {
+      int order;
+      if(keys == NULL || keyIt == keys->end())
+      {
+         order = 1;
+      }
+      else if(ruleIndex == rule->keys.size())
+      {
+         order = -1;
+      }
+      else
+      {
+         order = keyIt->first.compare(rule->keys[ruleIndex].name);
+      }
+
+      if(order < 0)
+      {
+         AddViolation(violations, section, keyIt->first, config.mValues.Line(keyIt->second), "unknown key");
+         ++keyIt;
+      }
+      else if(order > 0)
+      {
+         const KeyRule& keyRule = rule->keys[ruleIndex];
+         if(keyRule.required)
+         {
+            if(!inheritedFound)
+            {
+               ConfigParser::SectionIndex::const_iterator inheritedIt = config.mInherited.find(section);
+               inherited = (inheritedIt == config.mInherited.end()) ? NULL : &inheritedIt->second;
+               inheritedFound = true;
+            }
+            if(inherited == NULL || inherited->find(keyRule.name) == inherited->end())
+            {
+               AddViolation(violations, section, keyRule.name, 0, "missing required key");
+            }
+         }
+         ruleIndex++;
+      }
+      else
+      {
+         CheckValue(config, section, keyIt->second, rule->keys[ruleIndex], violations);
+         ++keyIt;
+         ruleIndex++;
+      }
+   }
+}
+
+void ConfigSchema::CheckValue(const ConfigParser& config, const std::string& section, size_t index, const KeyRule& rule,
+   std::vector<SchemaViolation>& violations) const
+{
+   const Value& cell = config.mValues.Cell(index);
+   TokenType type = cell.Type();
+   const std::string& key = rule.name;
+   int line = config.mValues.Line(index);
+
+   bool typeMatches = true;
+   switch(rule.type)
+   {
+   case ANY_TYPE:
+      break;
+   case INTEGER_TYPE:
+      typeMatches = (type == INTEGER);
+      break;
+   case REAL_TYPE:
+      typeMatches = (type == INTEGER || type == REAL_NUMBER);
+      break;
+   case BOOL_TYPE:
+      typeMatches = (type == BOOL);
+      break;
+   case STRING_TYPE:
+      typeMatches = (type == STRING);
+      break;
+   case LIST_TYPE:
+      typeMatches = (type == LIST);
+      break;
+   }
+   if(!typeMatches)
+   {
+      AddViolation(violations, section, key, line, std::string("expected ") + TypeName(rule.type));
+      return;
+   }
+
+   if((rule.hasMin || rule.hasMax) && (type == INTEGER || type == REAL_NUMBER))
+   {
+      double number;
+      if(cell.GetStorage() == Value::REAL_BITS)
+      {
+         number = cell.Real();
+      }
+      else if(cell.GetStorage() == Value::NUMBER_BITS)
+      {
+         number = static_cast<double>(cell.Integer());
+      }
+      else
+      {
+         //Numbers not written canonically (0x10, 2.0) or too large to
+         //convert keep their text
+         try
+         {
+            std::string text = config.mValues.Text(index);
+            number = (type == INTEGER) ? static_cast<double>(Str2LongLong(text)) : Str2Double(text);
+         }
+         catch(std::logic_error&)
+         {
+            AddViolation(violations, section, key, line, "out of range");
+            return;
+         }
+      }
+      if((rule.hasMin && number < rule.min) || (rule.hasMax && number > rule.max))
+      {
+         std::ostringstream message;
+         message << "out of range [";
+         if(rule.hasMin)
+         {
+            message << rule.min;
+         }
+         message << ", ";
+         if(rule.hasMax)
+         {
+            message << rule.max;
+         }
+         message << "]";
+         AddViolation(violations, section, key, line, message.str());
+      }
+   }
+
+   if(!rule.values.empty() && type == STRING)
+   {
+      std::string text = config.mValues.Text(index);
+      for(size_t i = 0; i < rule.values.size(); i++)
+      {
+         if(text == rule.values[i])
+         {
+            return;
+         }
+      }
+      AddViolation(violations, section, key, line, "value " + text + " not allowed");
+   }
+}
+
+}
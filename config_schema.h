@@ -0,0 +1,90 @@
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <string>
+#include <vector>
+#include "config_parser.h"
+
+namespace SimpleConfig
+{
+
+typedef enum schemaType
+{
+   ANY_TYPE, INTEGER_TYPE, REAL_TYPE, BOOL_TYPE, STRING_TYPE, LIST_TYPE
+} SchemaType;
+
+//One way a config breaks its schema. line is 0 for missing keys.
+typedef struct schemaViolation
+{
+   std::string section;
+   std::string key;  //Empty for an unknown section
+   int line;
+   std::string message;
+} SchemaViolation;
+
+//A schema loaded from an INI file and compiled for validation. The
+//schema has one section per allowed key, named section.key (split at
+//the last '.'; a key of the unnamed section is named by itself):
+//
+//   [server.port]
+//   type = "integer"   # any, integer, real, bool, string or list
+//   required = true    # optional, default false
+//   min = 1            # optional, integer and real keys
+//   max = 65535
+//
+//   [log.level]
+//   type = "string"
+//   values = ["debug", "info", "error"]   # optional, allowed strings
+//
+//A real key also accepts integers. Sections and keys the schema does
+//not name are violations.
+//
+//Compiling sorts the entries in the parser's index order, so Validate
+//walks the config and the schema side by side once, comparing names
+//instead of looking each key up, and reads values straight from their
+//cells.
+class ConfigSchema
+{
+public:
+   //Throws std::invalid_argument for an entry without a type or with an
+   //unknown type or field, and std::logic_error for a field of the
+   //wrong type
+   explicit ConfigSchema(const ConfigParser& schema);
+   explicit ConfigSchema(const std::string& filename);
+
+   //Every violation in config, in section and key order. Keys a dotted
+   //section inherits satisfy required entries but are not checked
+   //against its own entries.
+   std::vector<SchemaViolation> Validate(const ConfigParser& config) const;
+
+private:
+   typedef struct keyRule
+   {
+      std::string name;
+      SchemaType type;
+      bool required;
+      bool hasMin;
+      bool hasMax;
+      double min;
+      double max;
+      std::vector<std::string> values;
+   } KeyRule;
+
+   typedef struct sectionRule
+   {
+      std::string name;
+      std::vector<KeyRule> keys; //Sorted by name
+   } SectionRule;
+
+   void Compile(const ConfigParser& schema);
+   void CheckSection(const ConfigParser& config, const std::string& section, const ConfigParser::KeyIndex* keys,
+      const SectionRule* rule, std::vector<SchemaViolation>& violations) const;
+   void CheckValue(const ConfigParser& config, const std::string& section, size_t index, const KeyRule& rule,
+      std::vector<SchemaViolation>& violations) const;
+
+   std::vector<SectionRule> mSections; //Sorted by name
+};
+
+}
+
+#endif /* CONFIG_SCHEMA_H */
@@ -0,0 +1,169 @@
+#include "config_schema.h"
+#include "config_parser.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+SimpleConfig::ConfigParser Parsed(const std::string& text)
+{
+   SimpleConfig::ConfigParser config;
+   std::istringstream stream(text);
+   config.Parse(stream);
+   return config;
+}
+
+class ConfigSchemaTest : public ::testing::Test
+{
+protected:
+
+   ConfigSchemaTest(): schema(Parsed(
+      "[verbose]\n"
+      "type = \"bool\"\n"
+      "[server.port]\n"
+      "type = \"integer\"\n"
+      "required = true\n"
+      "min = 1\n"
+      "max = 65535\n"
+      "[server.ratio]\n"
+      "type = \"real\"\n"
+      "max = 1\n"
+      "[server.hosts]\n"
+      "type = \"list\"\n"
+      "[server.tls.cert_file]\n"
+      "type = \"string\"\n"
+      "required = true\n"
+      "[log.level]\n"
+      "type = \"string\"\n"
+      "values = [\"debug\", \"info\", \"error\"]\n"
+      "[log.extra]\n"
+      "type = \"any\"\n"))
+   {
+   }
+
+   std::vector<SimpleConfig::SchemaViolation> Validate(const std::string& text)
+   {
+      return schema.Validate(Parsed(text));
+   }
+
+   SimpleConfig::ConfigSchema schema;
+};
+
+TEST_F(ConfigSchemaTest, ValidConfigPasses)
+{
+   EXPECT_TRUE(Validate(
+      "verbose = true\n"
+      "[server]\n"
+      "port = 8080\n"
+      "ratio = 1\n"
+      "hosts = [\"a\", \"b\"]\n"
+      "[server.tls]\n"
+      "cert_file = \"/etc/cert\"\n"
+      "[log]\n"
+      "level = \"info\"\n"
+      "extra = [1, 2]\n").empty());
+}
+
+TEST_F(ConfigSchemaTest, EveryViolationReported)
+{
+   std::vector<SimpleConfig::SchemaViolation> violations = Validate(
+      "verbose = 1\n"
+      "[server]\n"
+      "port = 70000\n"
+      "ratio = 0.5\n"
+      "hosts = \"a\"\n"
+      "colour = \"red\"\n"
+      "[log]\n"
+      "level = \"loud\"\n"
+      "[cache]\n"
+      "size = 5\n");
+   ASSERT_EQ(7u, violations.size());
+
+   //Section and key order: "", cache, log, server, server.tls
+   EXPECT_EQ("", violations[0].section);
+   EXPECT_EQ("verbose", violations[0].key);
+   EXPECT_EQ(1, violations[0].line);
+   EXPECT_EQ("expected bool", violations[0].message);
+
+   EXPECT_EQ("cache", violations[1].section);
+   EXPECT_EQ("", violations[1].key);
+   EXPECT_EQ(10, violations[1].line);
+   EXPECT_EQ("unknown section", violations[1].message);
+
+   EXPECT_EQ("level", violations[2].key);
+   EXPECT_EQ("value loud not allowed", violations[2].message);
+
+   EXPECT_EQ("colour", violations[3].key);
+   EXPECT_EQ(6, violations[3].line);
+   EXPECT_EQ("unknown key", violations[3].message);
+
+   EXPECT_EQ("hosts", violations[4].key);
+   EXPECT_EQ("expected list", violations[4].message);
+
+   EXPECT_EQ("port", violations[5].key);
+   EXPECT_EQ(3, violations[5].line);
+   EXPECT_EQ("out of range [1, 65535]", violations[5].message);
+
+   EXPECT_EQ("server.tls", violations[6].section);
+   EXPECT_EQ("cert_file", violations[6].key);
+   EXPECT_EQ(0, violations[6].line);
+   EXPECT_EQ("missing required key", violations[6].message);
+}
+
+TEST_F(ConfigSchemaTest, RangesAndTypes)
+{
+   std::vector<SimpleConfig::SchemaViolation> violations = Validate(
+      "[server]\n"
+      "port = 0x10000\n"
+      "ratio = 1.50\n"
+      "[server.tls]\n"
+      "cert_file = 5\n");
+   ASSERT_EQ(3u, violations.size());
+   EXPECT_EQ("port", violations[0].key);
+   EXPECT_EQ("out of range [1, 65535]", violations[0].message);
+   EXPECT_EQ("ratio", violations[1].key);
+   EXPECT_EQ("out of range [, 1]", violations[1].message);
+   EXPECT_EQ("cert_file", violations[2].key);
+   EXPECT_EQ("expected string", violations[2].message);
+}
+
+//server.tls inherits port from server; its inherited keys are not
+//checked against server.tls entries
+TEST(ConfigSchemaInheritanceTest, InheritedKeysSatisfyRequired)
+{
+   SimpleConfig::ConfigSchema schema(Parsed(
+      "[server.port]\n"
+      "type = \"integer\"\n"
+      "required = true\n"
+      "[server.tls.port]\n"
+      "type = \"integer\"\n"
+      "required = true\n"
+      "[server.tls.cert_file]\n"
+      "type = \"string\"\n"));
+   EXPECT_TRUE(schema.Validate(Parsed(
+      "[server]\n"
+      "port = 443\n"
+      "[server.tls]\n"
+      "cert_file = \"/etc/cert\"\n")).empty());
+
+   std::vector<SimpleConfig::SchemaViolation> violations = schema.Validate(Parsed(""));
+   ASSERT_EQ(2u, violations.size());
+   EXPECT_EQ("server", violations[0].section);
+   EXPECT_EQ("server.tls", violations[1].section);
+}
+
+TEST(ConfigSchemaCompileTest, BadSchemasThrow)
+{
+   EXPECT_THROW(SimpleConfig::ConfigSchema(Parsed("[a.b]\nrequired = true\n")), std::invalid_argument);
+   EXPECT_THROW(SimpleConfig::ConfigSchema(Parsed("[a.b]\ntype = \"number\"\n")), std::invalid_argument);
+   EXPECT_THROW(SimpleConfig::ConfigSchema(Parsed("[a.b]\ntype = \"integer\"\nmaximum = 5\n")), std::invalid_argument);
+   EXPECT_THROW(SimpleConfig::ConfigSchema(Parsed("[a.b]\n[a.c]\ntype = \"integer\"\n")), std::invalid_argument);
+   EXPECT_THROW(SimpleConfig::ConfigSchema(Parsed("type = \"integer\"\n")), std::invalid_argument);
+   EXPECT_THROW(SimpleConfig::ConfigSchema(Parsed("[a.b]\ntype = 5\n")), std::logic_error);
+}
+
+}
@@ -0,0 +1,199 @@
+#include "config_source.h"
+#include "parse_utilities.h"
+#include <stdexcept>
+#include <sstream>
+
+namespace SimpleConfig
+{
+
+ConfigSource::ConfigSource()
+{}
+
+ConfigSource::~ConfigSource()
+{}
+
+Token ConfigSource::Lookup(const std::string& section, const std::string& key) const
+{
+   Token tok;
+   if(!Find(section, key, tok))
+   {
+      throw std::invalid_argument("Key " + key + " not found in section " + section);
+   }
+   return tok;
+}
+
+
+bool ConfigSource::LookupBoolean(const std::string& section, const std::string& key) const
+{
+   bool value;
+   Token tok = Lookup(section, key); //Throws if not found
+
+   try
+   {
+      value = Str2Bool(tok.lexeme);
+   }
+   catch(std::logic_error& e)
+   {
+      ConversionError(section, key, e.what(), tok.lineNum);
+   }
+
+   return value;
+}
+
+bool ConfigSource::LookupBoolean(const std::string& key) const
+{
+   return LookupBoolean("", key);
+}
+
+double ConfigSource::LookupDouble(const std::string& section, const std::string& key) const
+{
+   double value;
+   Token tok = Lookup(section, key); //Throws if not found
+
+   try
+   {
+      value = Str2Double(tok.lexeme);
+   }
+   catch(std::logic_error& e)
+   {
+      ConversionError(section, key, e.what(), tok.lineNum);
+   }
+   return value;
+}
+
+double ConfigSource::LookupDouble(const std::string& key) const
+{
+   return LookupDouble("", key);
+}
+
+
+int ConfigSource::LookupInteger(const std::string& section, const std::string& key) const
+{
+   int value;
+   Token tok = Lookup(section, key); //Throws if not found
+
+   try
+   {
+      value = Str2Int(tok.lexeme);
+   }
+   catch(std::logic_error& e)
+   {
+      ConversionError(section, key, e.what(), tok.lineNum);
+   }
+
+   return value;
+}
+
+int ConfigSource::LookupInteger(const std::string& key) const
+{
+   return LookupInteger("", key);
+}
+
+std::string ConfigSource::LookupString(const std::string& section, const std::string& key) const
+{
+   Token tok = Lookup(section, key); //Throws if not found
+   return tok.lexeme;
+}
+
+std::string ConfigSource::LookupString(const std::string& key) const
+{
+   return LookupString("", key);
+}
+
+
+size_t ConfigSource::LookupBatch(const std::string& section, LookupRequest* requests, size_t count) const
+{
+   size_t failed = 0;
+   Token tok;
+   for(size_t i = 0; i < count; i++)
+   {
+      if(!Find(section, requests[i].key, tok))
+      {
+         requests[i].status = LOOKUP_MISSING;
+      }
+      else if(!ConvertText(tok.lexeme, requests[i]))
+      {
+         requests[i].status = LOOKUP_WRONG_TYPE;
+      }
+      else
+      {
+         requests[i].status = LOOKUP_OK;
+         continue;
+      }
+      failed++;
+   }
+   return failed;
+}
+
+void ConfigSource::LookupAll(const std::string& section, LookupRequest* requests, size_t count) const
+{
+   if(LookupBatch(section, requests, count) == 0)
+   {
+      return;
+   }
+
+   std::string msg;
+   for(size_t i = 0; i < count; i++)
+   {
+      if(requests[i].status == LOOKUP_OK)
+      {
+         continue;
+      }
+      if(!msg.empty())
+      {
+         msg += "\n";
+      }
+      if(requests[i].status == LOOKUP_MISSING)
+      {
+         msg += "Key " + requests[i].key + " not found in section " + section;
+      }
+      else
+      {
+         msg += "Key " + requests[i].key + " in section " + section + " has the wrong type";
+      }
+   }
+   throw std::invalid_argument(msg);
+}
+
+bool ConfigSource::ConvertText(const std::string& text, LookupRequest& request)
+{
+   try
+   {
+      switch(request.type)
+      {
+      case BOOLEAN_VALUE:
+         *static_cast<bool*>(request.destination) = Str2Bool(text);
+         break;
+      case DOUBLE_VALUE:
+         *static_cast<double*>(request.destination) = Str2Double(text);
+         break;
+      case INTEGER_VALUE:
+         *static_cast<int*>(request.destination) = Str2Int(text);
+         break;
+      case STRING_VALUE:
+         *static_cast<std::string*>(request.destination) = text;
+         break;
+      }
+   }
+   catch(std::logic_error&)
+   {
+      return false;
+   }
+   return true;
+}
+
+
+void ConfigSource::ConversionError(std::string section, std::string key, std::string caughtMsg, int sourceLine) const
+{
+   std::stringstream msgBuf;
+   msgBuf << "Conversion error in lookup ";
+   if(!section.empty())
+   {
+      msgBuf << "\"" << section << "\":";
+   }
+   msgBuf << "\"" << key << "\" (source line " << sourceLine <<")\n";
+   msgBuf << caughtMsg;
+   throw std::logic_error(msgBuf.str());
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef CONFIG_SOURCE_H
+#define CONFIG_SOURCE_H
+
+#include <string>
+#include "config_lexer.h"
+
+namespace SimpleConfig
+{
+
+typedef enum lookupType
+{
+   BOOLEAN_VALUE, DOUBLE_VALUE, INTEGER_VALUE, STRING_VALUE
+} LookupType;
+
+typedef enum lookupStatus
+{
+   LOOKUP_OK, LOOKUP_MISSING, LOOKUP_WRONG_TYPE
+} LookupStatus;
+
+//One key of a batch lookup. destination points to a bool, double, int
+//or std::string matching type, and is only written when status is
+//LOOKUP_OK.
+typedef struct lookupRequest
+{
+   std::string key;
+   LookupType type;
+   void* destination;
+   LookupStatus status;
+} LookupRequest;
+
+//Common read interface of everything that can answer lookups.
+//Implementations only provide Find; the typed lookups and their
+//error reporting are shared.
+class ConfigSource
+{
+public:
+   ConfigSource();
+   virtual ~ConfigSource();
+
+   //Copies the value of section:key into value. Returns false if not found.
+   virtual bool Find(const std::string& section, const std::string& key, Token& value) const = 0;
+
+   Token Lookup(const std::string& section, const std::string& key) const;
+
+   virtual bool LookupBoolean(const std::string& section, const std::string& key) const;
+   bool LookupBoolean(const std::string& key) const;
+
+   virtual double LookupDouble(const std::string& section, const std::string& key) const;
+   double LookupDouble(const std::string& key) const;
+
+   virtual int LookupInteger(const std::string& section, const std::string& key) const;
+   int LookupInteger(const std::string& key) const;
+
+   virtual std::string LookupString(const std::string& section, const std::string& key) const;
+   std::string LookupString(const std::string& key) const;
+
+   //Looks up every request in section without throwing, setting each
+   //status. Returns the number of requests that failed.
+   virtual size_t LookupBatch(const std::string& section, LookupRequest* requests, size_t count) const;
+
+   //As LookupBatch, but throws std::invalid_argument naming every
+   //missing or mistyped key if any failed
+   void LookupAll(const std::string& section, LookupRequest* requests, size_t count) const;
+
+protected:
+   void ConversionError(std::string section, std::string key, std::string caughtMsg, int sourceLine) const;
+
+   //Converts text to the request's type. Returns false if it does not convert.
+   static bool ConvertText(const std::string& text, LookupRequest& request);
+};
+
+}
+
+#endif /* CONFIG_SOURCE_H */
@@ -0,0 +1,108 @@
+#include "embedded_config.h"
+#include <cstring>
+
+namespace SimpleConfig
+{
+
+//32 bit FNV-1a over the section, a zero byte and the key
+unsigned int EmbeddedHash(const char* section, size_t sectionLength, const char* key, size_t keyLength)
+{
+   unsigned int hash = 2166136261u;
+   for(size_t i = 0; i < sectionLength; i++)
+   {
+      hash = (hash ^ static_cast<unsigned char>(section[i])) * 16777619u;
+   }
+   hash *= 16777619u;
+   for(size_t i = 0; i < keyLength; i++)
+   {
+      hash = (hash ^ static_cast<unsigned char>(key[i])) * 16777619u;
+   }
+   return hash;
+}
+
+
+EmbeddedConfig::EmbeddedConfig(const EmbeddedTable& table): mTable(table)
+{}
+
+EmbeddedConfig::~EmbeddedConfig()
+{}
+
+size_t EmbeddedConfig::Size() const
+{
+   return mTable.entryCount;
+}
+
+const EmbeddedEntry& EmbeddedConfig::Entry(size_t index) const
+{
+   return mTable.entries[index];
+}
+
+const EmbeddedEntry* EmbeddedConfig::FindEntry(const std::string& section, const std::string& key) const
+{
+   if(mTable.slotCount == 0)
+   {
+      return NULL;
+   }
+
+   size_t mask = mTable.slotCount - 1;
+   size_t slot = EmbeddedHash(section.data(), section.size(), key.data(), key.size()) & mask;
+   while(mTable.slots[slot] != 0)
+   {
+      const EmbeddedEntry& entry = mTable.entries[mTable.slots[slot] - 1];
+      if(section == entry.section && key == entry.key)
+      {
+         return &entry;
+      }
+      slot = (slot + 1) & mask;
+   }
+   return NULL;
+}
+
+bool EmbeddedConfig::Find(const std::string& section, const std::string& key, Token& value) const
+{
+   const EmbeddedEntry* entry = FindEntry(section, key);
+   if(entry == NULL)
+   {
+      return false;
+   }
+   value.type = entry->type;
+   value.lexeme = entry->text;
+   value.lineNum = entry->line;
+   return true;
+}
+
+bool EmbeddedConfig::LookupBoolean(const std::string& section, const std::string& key) const
+{
+   const EmbeddedEntry* entry = FindEntry(section, key);
+   if(entry && entry->converted && entry->type != REAL_NUMBER)
+   {
+      return entry->integer != 0;
+   }
+   return ConfigSource::LookupBoolean(section, key);
+}
+
+double EmbeddedConfig::LookupDouble(const std::string& section, const std::string& key) const
+{
+   const EmbeddedEntry* entry = FindEntry(section, key);
+   if(entry && entry->converted && entry->type == REAL_NUMBER)
+   {
+      return entry->real;
+   }
+   if(entry && entry->converted && entry->type == INTEGER)
+   {
+      return static_cast<double>(entry->integer);
+   }
+   return ConfigSource::LookupDouble(section, key);
+}
+
+int EmbeddedConfig::LookupInteger(const std::string& section, const std::string& key) const
+{
+   const EmbeddedEntry* entry = FindEntry(section, key);
+   if(entry && entry->converted && entry->type == INTEGER)
+   {
+      return static_cast<int>(entry->integer);
+   }
+   return ConfigSource::LookupInteger(section, key);
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef EMBEDDED_CONFIG_H
+#define EMBEDDED_CONFIG_H
+
+#include <string>
+#include <cstddef>
+#include "config_lexer.h"
+#include "config_source.h"
+
+namespace SimpleConfig
+{
+
+//One value of a config compiled into the program
+typedef struct embeddedEntry
+{
+   const char* section;
+   const char* key;
+   TokenType type;
+   const char* text;    //Source text, as LookupString returns it
+   bool converted;      //integer/real hold the value (INTEGER, BOOL, REAL_NUMBER)
+   long long integer;
+   double real;
+   int line;
+} EmbeddedEntry;
+
+//Table generated by cfgembed. Entries are sorted by section, then key.
+//slots is an open addressing hash table of entry index + 1 (0 for an
+//empty slot); slotCount is a power of two.
+typedef struct embeddedTable
+{
+   const EmbeddedEntry* entries;
+   size_t entryCount;
+   const unsigned int* slots;
+   size_t slotCount;
+} EmbeddedTable;
+
+//Hash of a section/key pair used for the slots of an EmbeddedTable
+unsigned int EmbeddedHash(const char* section, size_t sectionLength, const char* key, size_t keyLength);
+
+//Serves the ConfigSource lookups from a table generated at build time,
+//so nothing is parsed at run time. The table must outlive the object.
+class EmbeddedConfig : public ConfigSource
+{
+public:
+   explicit EmbeddedConfig(const EmbeddedTable& table);
+   ~EmbeddedConfig();
+
+   virtual bool Find(const std::string& section, const std::string& key, Token& value) const;
+
+   using ConfigSource::LookupBoolean;
+   using ConfigSource::LookupDouble;
+   using ConfigSource::LookupInteger;
+   virtual bool LookupBoolean(const std::string& section, const std::string& key) const;
+   virtual double LookupDouble(const std::string& section, const std::string& key) const;
+   virtual int LookupInteger(const std::string& section, const std::string& key) const;
+
+   size_t Size() const;
+   const EmbeddedEntry& Entry(size_t index) const;
+
+private:
+   const EmbeddedEntry* FindEntry(const std::string& section, const std::string& key) const;
+
+   const EmbeddedTable& mTable;
+};
+
+}
+
+#endif /* EMBEDDED_CONFIG_H */
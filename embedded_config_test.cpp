@@ -0,0 +1,73 @@
+#include "embedded_config.h"
+#include "config_parser.h"
+#include "gtest/gtest.h"
+#include <stdexcept>
+
+//Generated from embedded_test.ini by cfgembed
+extern const SimpleConfig::EmbeddedTable embedded_test_config;
+
+namespace
+{
+
+class EmbeddedConfigTest : public ::testing::Test
+{
+protected:
+
+   EmbeddedConfigTest(): config(embedded_test_config)
+   {
+      parsed.Parse("embedded_test.ini");
+   }
+
+   SimpleConfig::EmbeddedConfig config;
+   SimpleConfig::ConfigParser parsed;
+};
+
+TEST_F(EmbeddedConfigTest, TypedLookupsWork)
+{
+   EXPECT_EQ("server", config.LookupString("name"));
+   EXPECT_EQ(8080, config.LookupInteger("port"));
+   EXPECT_EQ(0.25, config.LookupDouble("ratio"));
+   EXPECT_TRUE(config.LookupBoolean("verbose"));
+   EXPECT_EQ(16, config.LookupInteger("mask"));
+   EXPECT_EQ("/srv/data?v=1/prod", config.LookupString("prod", "root"));
+   EXPECT_EQ("[1, 2, 3]", config.LookupString("prod", "levels"));
+   EXPECT_EQ(8, config.LookupInteger("prod.web", "threads"));
+}
+
+TEST_F(EmbeddedConfigTest, ErrorsMatchTheParser)
+{
+   EXPECT_THROW(config.LookupInteger("missing"), std::invalid_argument);
+   EXPECT_THROW(config.LookupInteger("prod", "port"), std::invalid_argument);
+   EXPECT_THROW(config.LookupInteger("name"), std::logic_error);
+   EXPECT_THROW(config.LookupInteger("huge"), std::logic_error);
+   EXPECT_THROW(parsed.LookupInteger("huge"), std::logic_error);
+}
+
+TEST_F(EmbeddedConfigTest, SameAnswersAsARuntimeParse)
+{
+   size_t count = 0;
+   for(SimpleConfig::ConfigParser::SectionRange::iterator sectionIt = parsed.Sections().begin(); sectionIt != parsed.Sections().end(); ++sectionIt)
+   {
+      SimpleConfig::ConfigParser::KeyRange keys = parsed.Keys(*sectionIt);
+      for(SimpleConfig::ConfigParser::KeyRange::iterator keyIt = keys.begin(); keyIt != keys.end(); ++keyIt)
+      {
+         SimpleConfig::Token expected = parsed.Lookup(*sectionIt, *keyIt);
+         SimpleConfig::Token actual = config.Lookup(*sectionIt, *keyIt);
+         EXPECT_EQ(expected.type, actual.type) << *sectionIt << "." << *keyIt;
+         EXPECT_EQ(expected.lexeme, actual.lexeme) << *sectionIt << "." << *keyIt;
+         EXPECT_EQ(expected.lineNum, actual.lineNum) << *sectionIt << "." << *keyIt;
+         count++;
+      }
+   }
+   //prod.web also sees the keys it inherits from prod
+   EXPECT_EQ(13u, count);
+   EXPECT_EQ(13u, config.Size());
+   EXPECT_EQ(parsed.LookupString("prod.web", "root"), config.LookupString("prod.web", "root"));
+}
+
+TEST(EmbeddedHashTest, SectionAndKeyAreSeparated)
+{
+   EXPECT_NE(SimpleConfig::EmbeddedHash("ab", 2, "c", 1), SimpleConfig::EmbeddedHash("a", 1, "bc", 2));
+}
+
+}
@@ -0,0 +1,248 @@
+#include "layered_config.h"
+#include <stdexcept>
+
+namespace SimpleConfig
+{
+
+typedef ConfigParser::KeyIndex KeyMap;
+
+LayeredConfig::LayeredConfig()
+{}
+
+LayeredConfig::~LayeredConfig()
+{
+   for(size_t i = 0; i < mLayers.size(); i++)
+   {
+      delete mLayers[i];
+   }
+}
+
+size_t LayeredConfig::AddLayer(const std::string& name, const ConfigParser& layer)
+{
+   mLayers.push_back(new ConfigParser(layer));
+   mLayerNames.push_back(name);
+   IndexLayer(mLayers.size() - 1);
+   return mLayers.size() - 1;
+}
+
+void LayeredConfig::ReplaceLayer(size_t index, const ConfigParser& layer)
+{
+   if(index >= mLayers.size())
+   {
+      throw std::out_of_range("No such config layer");
+   }
+
+   ConfigParser* old = mLayers[index];
+   mLayers[index] = new ConfigParser(layer);
+
+   //Keys that disappear from the layer fall through to lower layers
+   std::set<std::pair<std::string, std::string> > keys;
+   AffectedKeys(*old, keys);
+   delete old;
+   AffectedKeys(*mLayers[index], keys);
+
+   for(std::set<std::pair<std::string, std::string> >::const_iterator it = keys.begin(); it != keys.end(); ++it)
+   {
+      Resolve(it->first, it->second);
+   }
+}
+
+size_t LayeredConfig::LayerCount() const
+{
+   return mLayers.size();
+}
+
+const std::string& LayeredConfig::LayerName(size_t index) const
+{
+   if(index >= mLayerNames.size())
+   {
+      throw std::out_of_range("No such config layer");
+   }
+   return mLayerNames[index];
+}
+
+size_t LayeredConfig::Origin(const std::string& section, const std::string& key) const
+{
+   std::map<std::string, std::map<std::string, Entry> >::const_iterator sectionIt = mIndex.find(section);
+   if(sectionIt != mIndex.end())
+   {
+      std::map<std::string, Entry>::const_iterator keyIt = sectionIt->second.find(key);
+      if(keyIt != sectionIt->second.end())
+      {
+         return keyIt->second.layer;
+      }
+   }
+   throw std::invalid_argument("Key " + key + " not found in section " + section);
+}
+
+bool LayeredConfig::Find(const std::string& section, const std::string& key, Token& value) const
+{
+   std::map<std::string, std::map<std::string, Entry> >::const_iterator sectionIt = mIndex.find(section);
+   if(sectionIt == mIndex.end())
+   {
+      return false;
+   }
+
+   std::map<std::string, Entry>::const_iterator keyIt = sectionIt->second.find(key);
+   if(keyIt == sectionIt->second.end())
+   {
+      return false;
+   }
+
+   value = mLayers[keyIt->second.layer]->mValues.Get(keyIt->second.value);
+   return true;
+}
+
+//Used when a layer is pushed on top: all of its keys win, including
+//the ones its dotted sections inherit. The rest of the keys it affects,
+//in descendants it has no section for and inherited by its sections
+//from lower layers, are resolved one by one.
+void LayeredConfig::IndexLayer(size_t index)
+{
+   const ConfigParser& layer = *mLayers[index];
+   std::map<std::string, const KeyMap*> sections;
+   layer.VisibleSections(sections);
+   for(std::map<std::string, const KeyMap*>::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      std::map<std::string, Entry>& indexSection = mIndex[sectionIt->first];
+      for(KeyMap::const_iterator keyIt = sectionIt->second->begin(); keyIt != sectionIt->second->end(); ++keyIt)
+      {
+         Entry& e = indexSection[keyIt->first];
+         e.value = keyIt->second;
+         e.layer = index;
+      }
+   }
+
+   std::set<std::pair<std::string, std::string> > keys;
+   AffectedKeys(layer, keys);
+   for(std::set<std::pair<std::string, std::string> >::const_iterator it = keys.begin(); it != keys.end(); ++it)
+   {
+      size_t value;
+      if(!layer.FindIndex(it->first, it->second, value))
+      {
+         Resolve(it->first, it->second);
+      }
+   }
+}
+
+//Sections below section in any layer, e.g. a.b and a.b.c for a
+void LayeredConfig::Descendants(const std::string& section, std::set<std::string>& descendants) const
+{
+   if(section.empty())
+   {
+      return;
+   }
+
+   std::string prefix = section + ".";
+   for(size_t i = 0; i < mLayers.size(); i++)
+   {
+      const ConfigParser& layer = *mLayers[i];
+      for(ConfigParser::SectionIndex::const_iterator it = layer.parseMap.lower_bound(prefix);
+         it != layer.parseMap.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+      {
+         descendants.insert(it->first);
+      }
+      for(std::set<std::string>::const_iterator it = layer.mDottedSections.lower_bound(prefix);
+         it != layer.mDottedSections.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+      {
+         descendants.insert(*it);
+      }
+   }
+}
+
+//Every section:key that layer supplies or could supply: its visible
+//keys, the same keys in the descendants of their sections, and the keys
+//any layer has in the ancestors of its sections
+void LayeredConfig::AffectedKeys(const ConfigParser& layer, std::set<std::pair<std::string, std::string> >& keys) const
+{
+   std::map<std::string, const KeyMap*> sections;
+   layer.VisibleSections(sections);
+   for(std::map<std::string, const KeyMap*>::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      std::set<std::string> descendants;
+      Descendants(sectionIt->first, descendants);
+      descendants.insert(sectionIt->first);
+      for(std::set<std::string>::const_iterator it = descendants.begin(); it != descendants.end(); ++it)
+      {
+         for(KeyMap::const_iterator keyIt = sectionIt->second->begin(); keyIt != sectionIt->second->end(); ++keyIt)
+         {
+            keys.insert(std::make_pair(*it, keyIt->first));
+         }
+      }
+   }
+
+   std::set<std::string> dotted(layer.mDottedSections);
+   for(std::map<std::string, const KeyMap*>::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      dotted.insert(sectionIt->first);
+   }
+   for(std::set<std::string>::const_iterator sectionIt = dotted.begin(); sectionIt != dotted.end(); ++sectionIt)
+   {
+      std::string ancestor = *sectionIt;
+      std::string::size_type dot;
+      while((dot = ancestor.rfind('.')) != std::string::npos)
+      {
+         ancestor.erase(dot);
+         for(size_t i = 0; i < mLayers.size(); i++)
+         {
+            const KeyMap* ancestorKeys = mLayers[i]->FindSection(ancestor);
+            if(ancestorKeys == NULL)
+            {
+               continue;
+            }
+            for(KeyMap::const_iterator keyIt = ancestorKeys->begin(); keyIt != ancestorKeys->end(); ++keyIt)
+            {
+               keys.insert(std::make_pair(*sectionIt, keyIt->first));
+            }
+         }
+      }
+   }
+}
+
+//Re-resolves one key by searching the layers from the top down. In each
+//layer the section and then its ancestors are tried, nearest first; a
+//section no layer has keeps no keys.
+void LayeredConfig::Resolve(const std::string& section, const std::string& key)
+{
+   bool exists = false;
+   for(size_t i = 0; i < mLayers.size() && !exists; i++)
+   {
+      exists = (mLayers[i]->parseMap.find(section) != mLayers[i]->parseMap.end()) ||
+         (mLayers[i]->mDottedSections.find(section) != mLayers[i]->mDottedSections.end());
+   }
+
+   for(size_t i = mLayers.size(); exists && i > 0; i--)
+   {
+      std::string ancestor = section;
+      while(true)
+      {
+         size_t value;
+         if(mLayers[i-1]->FindIndex(ancestor, key, value))
+         {
+            Entry& e = mIndex[section][key];
+            e.value = value;
+            e.layer = i-1;
+            return;
+         }
+
+         std::string::size_type dot = ancestor.rfind('.');
+         if(dot == std::string::npos)
+         {
+            break;
+         }
+         ancestor.erase(dot);
+      }
+   }
+
+   std::map<std::string, std::map<std::string, Entry> >::iterator sectionIt = mIndex.find(section);
+   if(sectionIt != mIndex.end())
+   {
+      sectionIt->second.erase(key);
+      if(sectionIt->second.empty())
+      {
+         mIndex.erase(sectionIt);
+      }
+   }
+}
+
+}
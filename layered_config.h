@@ -0,0 +1,66 @@
+#ifndef LAYERED_CONFIG_H
+#define LAYERED_CONFIG_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include "config_source.h"
+#include "config_parser.h"
+
+namespace SimpleConfig
+{
+
+//A stack of configs (e.g. base, environment, host, overrides) flattened
+//into a single index. Layers added later override earlier ones. Each
+//entry remembers which layer it came from, and a lookup is a single
+//index probe regardless of the number of layers. A key missing from a
+//dotted section comes from its nearest ancestor that has it; across
+//layers, the topmost layer that has the key in the section or any
+//ancestor supplies it, so [a] x in an override layer reaches [a.b] of
+//the base layer.
+class LayeredConfig : public ConfigSource
+{
+public:
+   LayeredConfig();
+   ~LayeredConfig();
+
+   //Copies layer onto the top of the stack. Returns its index.
+   size_t AddLayer(const std::string& name, const ConfigParser& layer);
+
+   //Replaces the contents of an existing layer. Only the keys present in
+   //the old or new contents, and the same keys of their descendant
+   //sections, are re-resolved.
+   void ReplaceLayer(size_t index, const ConfigParser& layer);
+
+   size_t LayerCount() const;
+   const std::string& LayerName(size_t index) const;
+
+   //Index of the layer that supplies section:key. Throws if not found.
+   size_t Origin(const std::string& section, const std::string& key) const;
+
+   virtual bool Find(const std::string& section, const std::string& key, Token& value) const;
+
+private:
+   LayeredConfig(const LayeredConfig&);
+   LayeredConfig& operator=(const LayeredConfig&);
+
+   typedef struct entry
+   {
+      size_t value; //Index into the layer's value store
+      size_t layer;
+   } Entry;
+
+   void IndexLayer(size_t index);
+   void Descendants(const std::string& section, std::set<std::string>& descendants) const;
+   void AffectedKeys(const ConfigParser& layer, std::set<std::pair<std::string, std::string> >& keys) const;
+   void Resolve(const std::string& section, const std::string& key);
+
+   std::vector<std::string> mLayerNames;
+   std::vector<ConfigParser*> mLayers;
+   std::map<std::string, std::map<std::string, Entry> > mIndex;
+};
+
+}
+
+#endif /* LAYERED_CONFIG_H */
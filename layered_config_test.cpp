@@ -0,0 +1,133 @@
+#include "layered_config.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+SimpleConfig::ConfigParser ParseText(const std::string& text)
+{
+   std::istringstream configStream(text);
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   return c;
+}
+
+class LayeredConfigTest : public ::testing::Test
+{
+protected:
+
+   LayeredConfigTest()
+   {
+      config.AddLayer("base", ParseText("port=80\nname=\"base\"\n[Log]\nlevel=1\n"));
+      config.AddLayer("host", ParseText("port=8080\n[Log]\nverbose=true\n"));
+   }
+
+   SimpleConfig::LayeredConfig config;
+};
+
+TEST_F(LayeredConfigTest, TopLayerOverrides)
+{
+   EXPECT_EQ(8080, config.LookupInteger("port"));
+   EXPECT_EQ(1u, config.Origin("", "port"));
+   EXPECT_EQ("host", config.LayerName(config.Origin("", "port")));
+}
+
+TEST_F(LayeredConfigTest, LowerLayerVisibleWhenNotOverridden)
+{
+   EXPECT_EQ("base", config.LookupString("name"));
+   EXPECT_EQ(0u, config.Origin("", "name"));
+   EXPECT_EQ(1, config.LookupInteger("Log", "level"));
+   EXPECT_TRUE(config.LookupBoolean("Log", "verbose"));
+}
+
+TEST_F(LayeredConfigTest, MissingKeyThrows)
+{
+   EXPECT_THROW(config.LookupInteger("missing"), std::invalid_argument);
+   EXPECT_THROW(config.Origin("Log", "missing"), std::invalid_argument);
+}
+
+TEST_F(LayeredConfigTest, ReplaceLayerReresolvesAffectedKeys)
+{
+   config.ReplaceLayer(1, ParseText("name=\"host\"\n"));
+   EXPECT_EQ(80, config.LookupInteger("port"));
+   EXPECT_EQ(0u, config.Origin("", "port"));
+   EXPECT_EQ("host", config.LookupString("name"));
+   EXPECT_THROW(config.LookupBoolean("Log", "verbose"), std::invalid_argument);
+   EXPECT_EQ(1, config.LookupInteger("Log", "level"));
+}
+
+TEST_F(LayeredConfigTest, ReplaceBottomLayerKeepsOverrides)
+{
+   config.ReplaceLayer(0, ParseText("port=1\n"));
+   EXPECT_EQ(8080, config.LookupInteger("port"));
+   EXPECT_THROW(config.LookupString("name"), std::invalid_argument);
+}
+
+TEST_F(LayeredConfigTest, BatchLookupUsesResolvedValues)
+{
+   int port = 0;
+   bool verbose = false;
+   int level = 0;
+   SimpleConfig::LookupRequest requests[] = {
+      {"verbose", SimpleConfig::BOOLEAN_VALUE, &verbose, SimpleConfig::LOOKUP_MISSING},
+      {"level", SimpleConfig::INTEGER_VALUE, &level, SimpleConfig::LOOKUP_MISSING},
+      {"port", SimpleConfig::INTEGER_VALUE, &port, SimpleConfig::LOOKUP_OK}
+   };
+
+   EXPECT_EQ(1u, config.LookupBatch("Log", requests, 3));
+   EXPECT_TRUE(verbose);
+   EXPECT_EQ(1, level);
+   EXPECT_EQ(SimpleConfig::LOOKUP_MISSING, requests[2].status);
+}
+
+TEST(LayeredInheritanceTest, DottedSectionsSeeInheritedKeys)
+{
+   SimpleConfig::LayeredConfig config;
+   config.AddLayer("base", ParseText("[a]\nx=1\ny=2\n[a.b]\nz=3\n"));
+   EXPECT_EQ(1, config.LookupInteger("a.b", "x"));
+   EXPECT_EQ(0u, config.Origin("a.b", "x"));
+
+   config.AddLayer("host", ParseText("[a]\nx=5\n[a.b]\ny=6\n"));
+   EXPECT_EQ(5, config.LookupInteger("a.b", "x"));
+   EXPECT_EQ(6, config.LookupInteger("a.b", "y"));
+   EXPECT_EQ(3, config.LookupInteger("a.b", "z"));
+
+   //Keys the replaced layer inherited fall through to the base layer
+   config.ReplaceLayer(1, ParseText("[a.b]\ny=6\n"));
+   EXPECT_EQ(1, config.LookupInteger("a.b", "x"));
+   EXPECT_EQ(0u, config.Origin("a.b", "x"));
+}
+
+//A parent key from a higher layer beats the one a lower layer's child
+//section inherits within that layer
+TEST(LayeredInheritanceTest, HigherParentKeysReachLowerChildren)
+{
+   SimpleConfig::LayeredConfig config;
+   config.AddLayer("base", ParseText("[a]\nx=1\n[a.b]\nz=3\n[a.b.c]\nw=4\n"));
+   config.AddLayer("host", ParseText("[a]\nx=5\n"));
+   EXPECT_EQ(5, config.LookupInteger("a", "x"));
+   EXPECT_EQ(5, config.LookupInteger("a.b", "x"));
+   EXPECT_EQ(1u, config.Origin("a.b", "x"));
+   EXPECT_EQ(5, config.LookupInteger("a.b.c", "x"));
+   EXPECT_EQ(3, config.LookupInteger("a.b.c", "z"));
+
+   //The child's own key still wins within the base layer
+   config.AddLayer("override", ParseText("[a.b]\nx=7\n"));
+   EXPECT_EQ(7, config.LookupInteger("a.b.c", "x"));
+   EXPECT_EQ(5, config.LookupInteger("a", "x"));
+
+   config.ReplaceLayer(2, ParseText(""));
+   config.ReplaceLayer(1, ParseText("[c]\ny=1\n"));
+   EXPECT_EQ(1, config.LookupInteger("a.b", "x"));
+   EXPECT_EQ(0u, config.Origin("a.b.c", "x"));
+
+   //A section only the replaced layer had goes away
+   config.ReplaceLayer(1, ParseText("[a.d]\ny=2\n"));
+   EXPECT_EQ(1, config.LookupInteger("a.d", "x"));
+   config.ReplaceLayer(1, ParseText(""));
+   EXPECT_THROW(config.LookupInteger("a.d", "x"), std::invalid_argument);
+}
+
+}
@@ -0,0 +1,85 @@
+#include "memory_stream.h"
+#include <climits>
+
+namespace SimpleConfig
+{
+
+MemoryStreamBuf::MemoryStreamBuf(const char* data, size_t length)
+{
+   //The get area is never written through, so dropping const is safe
+   char* begin = const_cast<char*>(data);
+   setg(begin, begin, begin + length);
+}
+
+size_t MemoryStreamBuf::Position() const
+{
+   return gptr() - eback();
+}
+
+//Only called for diagnostics, so the line start is found by scanning back
+int MemoryStreamBuf::Column(size_t back) const
+{
+   const char* at = (back > Position()) ? eback() : gptr() - back;
+   const char* lineStart = at;
+   while(lineStart > eback() && lineStart[-1] != '\n')
+   {
+      lineStart--;
+   }
+   return static_cast<int>(at - lineStart) + 1;
+}
+
+std::streambuf::pos_type MemoryStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+   if(!(which & std::ios_base::in))
+   {
+      return pos_type(off_type(-1));
+   }
+
+   off_type base = 0;
+   if(dir == std::ios_base::cur)
+   {
+      base = gptr() - eback();
+   }
+   else if(dir == std::ios_base::end)
+   {
+      base = egptr() - eback();
+   }
+
+   off_type target = base + off;
+   if(target < 0 || target > egptr() - eback())
+   {
+      return pos_type(off_type(-1));
+   }
+   setg(eback(), eback() + target, egptr());
+   return pos_type(target);
+}
+
+std::streambuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+   return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+//The get area pointers are protected; naming them through this class
+//makes them callable on any stream buffer
+const char* BufferedBytes::Begin(std::streambuf* buf)
+{
+   return (buf->*(&BufferedBytes::gptr))();
+}
+
+const char* BufferedBytes::End(std::streambuf* buf)
+{
+   return (buf->*(&BufferedBytes::egptr))();
+}
+
+void BufferedBytes::Consume(std::streambuf* buf, size_t count)
+{
+   while(count > 0)
+   {
+      int step = count > INT_MAX ? INT_MAX : static_cast<int>(count);
+      (buf->*(&BufferedBytes::gbump))(step);
+      count -= step;
+   }
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef MEMORY_STREAM_H
+#define MEMORY_STREAM_H
+
+#include <streambuf>
+#include <istream>
+#include <cstddef>
+
+namespace SimpleConfig
+{
+
+//Read-only stream buffer over memory owned by the caller. Lets the
+//lexer read a buffer in place instead of copying it into a stringstream.
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+   MemoryStreamBuf(const char* data, size_t length);
+
+   //Offset of the next character to be read
+   size_t Position() const;
+
+   //Column, counting bytes from 1, of the byte back bytes before the
+   //next one to be read
+   int Column(size_t back) const;
+
+protected:
+   virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which);
+   virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+};
+
+
+//Direct access to the bytes any stream buffer has already read ahead,
+//so the lexer can scan them in place instead of one get() at a time
+class BufferedBytes : public std::streambuf
+{
+public:
+   static const char* Begin(std::streambuf* buf);
+   static const char* End(std::streambuf* buf);
+
+   //Marks count bytes from Begin as read
+   static void Consume(std::streambuf* buf, size_t count);
+};
+
+}
+
+#endif /* MEMORY_STREAM_H */
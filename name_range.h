@@ -0,0 +1,72 @@
+#ifndef NAME_RANGE_H
+#define NAME_RANGE_H
+
+#include <string>
+#include <iterator>
+#include <cstddef>
+
+namespace SimpleConfig
+{
+
+//Iterator over the names (keys) of a sorted map. Dereferences to the
+//name stored in the map, so iterating never allocates.
+template<typename Map>
+class NameIterator
+{
+public:
+   typedef std::forward_iterator_tag iterator_category;
+   typedef std::string value_type;
+   typedef std::ptrdiff_t difference_type;
+   typedef const std::string* pointer;
+   typedef const std::string& reference;
+
+   NameIterator() {}
+   explicit NameIterator(typename Map::const_iterator it): mIt(it) {}
+
+   const std::string& operator*() const { return mIt->first; }
+   const std::string* operator->() const { return &mIt->first; }
+   NameIterator& operator++() { ++mIt; return *this; }
+   NameIterator operator++(int) { NameIterator old(*this); ++mIt; return old; }
+   bool operator==(const NameIterator& other) const { return mIt == other.mIt; }
+   bool operator!=(const NameIterator& other) const { return mIt != other.mIt; }
+
+private:
+   typename Map::const_iterator mIt;
+};
+
+//Names of a sorted map, all of them or those starting with a prefix.
+//Valid as long as the object that handed it out is alive and unmodified.
+template<typename Map>
+class NameRange
+{
+public:
+   typedef NameIterator<Map> iterator;
+   typedef NameIterator<Map> const_iterator;
+
+   explicit NameRange(const Map& map): mBegin(map.begin()), mEnd(map.end()) {}
+
+   //The names starting with prefix are consecutive in the map: find the
+   //first by binary search, then walk to the first one past it
+   NameRange(const Map& map, const std::string& prefix)
+   {
+      typename Map::const_iterator it = map.lower_bound(prefix);
+      mBegin = iterator(it);
+      while(it != map.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+      {
+         ++it;
+      }
+      mEnd = iterator(it);
+   }
+
+   iterator begin() const { return mBegin; }
+   iterator end() const { return mEnd; }
+   bool empty() const { return mBegin == mEnd; }
+
+private:
+   iterator mBegin;
+   iterator mEnd;
+};
+
+}
+
+#endif /* NAME_RANGE_H */
@@ -0,0 +1,67 @@
+#include "config_parser.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+//Usage: parse_bench [megabytes]
+//Times sequential and pipelined parses of a generated config
+namespace
+{
+
+std::string GeneratedConfig(size_t bytes)
+{
+   std::ostringstream out;
+   for(int s = 0; static_cast<size_t>(out.tellp()) < bytes; s++)
+   {
+      out << "[generated_section_" << s << "]\n";
+      for(int k = 0; k < 100; k++)
+      {
+         out << "# setting " << k << " of section " << s << "\n";
+         out << "integer_" << k << " = " << s * 131 + k << "\n";
+         out << "real_" << k << " = " << k << ".25\n";
+         out << "string_" << k << " = \"/var/lib/generated/" << s << "/" << k << "\"\n";
+         out << "flag_" << k << " = " << ((k % 2) ? "true" : "false") << "\n";
+      }
+   }
+   return out.str();
+}
+
+double SecondsToParse(const std::string& text, bool pipelined)
+{
+   double best = 0;
+   for(int run = 0; run < 3; run++)
+   {
+      std::istringstream source(text);
+      SimpleConfig::ConfigParser parser;
+      parser.PipelineLexing(pipelined);
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      parser.Parse(source);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if(run == 0 || elapsed.count() < best)
+      {
+         best = elapsed.count();
+      }
+   }
+   return best;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+   size_t megabytes = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 64;
+   std::string text = GeneratedConfig(megabytes * 1024 * 1024);
+   double megabytesParsed = text.size() / (1024.0 * 1024.0);
+
+   double sequential = SecondsToParse(text, false);
+   double pipelined = SecondsToParse(text, true);
+
+   std::cout << "input:      " << megabytesParsed << " MiB\n";
+   std::cout << "sequential: " << sequential << " s (" << megabytesParsed / sequential << " MiB/s)\n";
+   std::cout << "pipelined:  " << pipelined << " s (" << megabytesParsed / pipelined << " MiB/s)\n";
+   std::cout << "speedup:    " << sequential / pipelined << "x" << std::endl;
+   return 0;
+}
@@ -0,0 +1,265 @@
+#include "parse_cache.h"
+#include "config_parser.h"
+#include "parse_utilities.h"
+#include "memory_stream.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SimpleConfig
+{
+
+static std::string FileKey(const struct stat& info)
+{
+   return LongLong2Str(info.st_dev) + ":" + LongLong2Str(info.st_ino) + ":" +
+      LongLong2Str(info.st_size) + ":" + LongLong2Str(info.st_mtim.tv_sec) + "." +
+      LongLong2Str(info.st_mtim.tv_nsec);
+}
+
+static std::string DirectoryOf(const std::string& path)
+{
+   std::string::size_type slash = path.rfind('/');
+   if(slash == std::string::npos)
+   {
+      return "";
+   }
+   return path.substr(0, slash + 1);
+}
+
+//Closes the descriptor on every way out of Acquire
+class FileCloser
+{
+public:
+   explicit FileCloser(int fd): mFd(fd) {}
+   ~FileCloser() { close(mFd); }
+
+private:
+   int mFd;
+};
+
+
+ParseCache::ParseCache(size_t capacity /* =DEFAULT_CAPACITY */):
+   mCapacity(capacity), mBytes(0), mHits(0), mMisses(0), mEvictions(0)
+{}
+
+ParseCache::~ParseCache()
+{}
+
+ParseCache& ParseCache::Global()
+{
+   static ParseCache cache;
+   return cache;
+}
+
+std::shared_ptr<const ConfigParser> ParseCache::Parse(const std::string& path)
+{
+   return Acquire(path, "");
+}
+
+void ParseCache::SetCapacity(size_t capacity)
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   mCapacity = capacity;
+   EvictToFit();
+}
+
+size_t ParseCache::Capacity() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mCapacity;
+}
+
+ParseCacheStats ParseCache::Stats() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   ParseCacheStats stats;
+   stats.hits = mHits;
+   stats.misses = mMisses;
+   stats.evictions = mEvictions;
+   stats.entries = mRecent.size();
+   stats.bytes = mBytes;
+   return stats;
+}
+
+//Parsed entries only; files being parsed are not counted
+size_t ParseCache::Size() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mRecent.size();
+}
+
+//Entries being parsed are kept so their waiters are not left behind
+void ParseCache::Clear()
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   std::map<std::string, Entry>::iterator it = mEntries.begin();
+   while(it != mEntries.end())
+   {
+      if(it->second.result)
+      {
+         mBytes -= it->second.bytes;
+         mRecent.erase(it->second.recent);
+         mEntries.erase(it++);
+      }
+      else
+      {
+         ++it;
+      }
+   }
+}
+
+std::shared_ptr<const ConfigParser> ParseCache::Acquire(const std::string& path, const std::string& parent)
+{
+   int fd = open(path.c_str(), O_RDONLY);
+   if(fd < 0)
+   {
+      throw std::runtime_error("Could not open file " + path);
+   }
+   FileCloser closer(fd);
+
+   struct stat info;
+   if(fstat(fd, &info) != 0)
+   {
+      throw std::runtime_error("Could not read file " + path);
+   }
+   std::string key = FileKey(info);
+
+   std::unique_lock<std::mutex> lock(mMutex);
+   if(!parent.empty())
+   {
+      //Waiting on a file that (through its own includes) waits on the
+      //parent would never finish
+      if(key == parent || Reaches(key, parent))
+      {
+         throw std::runtime_error("Include cycle through " + path);
+      }
+      std::map<std::string, Entry>::iterator parentIt = mEntries.find(parent);
+      if(parentIt != mEntries.end())
+      {
+         parentIt->second.includes.push_back(key);
+      }
+   }
+
+   std::map<std::string, Entry>::iterator it = mEntries.find(key);
+   while(it != mEntries.end() && !it->second.result)
+   {
+      mParsed.wait(lock);
+      it = mEntries.find(key);
+   }
+   if(it != mEntries.end())
+   {
+      mHits++;
+      if(it->second.recent != mRecent.begin())
+      {
+         mRecent.splice(mRecent.begin(), mRecent, it->second.recent);
+      }
+      return it->second.result;
+   }
+   mMisses++;
+   mEntries[key];
+   lock.unlock();
+
+   std::shared_ptr<ConfigParser> parser(new ConfigParser());
+   try
+   {
+      std::string contents;
+      contents.resize(info.st_size);
+      size_t total = 0;
+      while(total < contents.size())
+      {
+         ssize_t count = read(fd, &contents[total], contents.size() - total);
+         if(count < 0)
+         {
+            throw std::runtime_error("Could not read file " + path);
+         }
+         if(count == 0)
+         {
+            break;
+         }
+         total += count;
+      }
+      contents.resize(total);
+
+      parser->mIncludeDir = DirectoryOf(path);
+      parser->mIncludeKey = key;
+      MemoryStreamBuf buf(contents.data(), contents.size());
+      std::istream file(&buf);
+      parser->ParseFileStream(file);
+   }
+   catch(std::runtime_error& e)
+   {
+      Abandon(lock, key);
+      throw std::runtime_error(path + ": " + e.what());
+   }
+   catch(...)
+   {
+      Abandon(lock, key);
+      throw;
+   }
+
+   size_t bytes = sizeof(ConfigParser) + parser->MemoryUsage();
+
+   lock.lock();
+   Entry& entry = mEntries[key];
+   entry.result = parser;
+   std::vector<std::string>().swap(entry.includes);
+   entry.recent = mRecent.insert(mRecent.begin(), key);
+   entry.bytes = bytes;
+   mBytes += bytes;
+   EvictToFit();
+   mParsed.notify_all();
+   return parser;
+}
+
+//Drops least recently used parses until the rest fit. A parse larger
+//than the whole capacity is handed to its caller but not kept.
+void ParseCache::EvictToFit()
+{
+   while(mBytes > mCapacity && !mRecent.empty())
+   {
+      std::map<std::string, Entry>::iterator it = mEntries.find(mRecent.back());
+      mBytes -= it->second.bytes;
+      mRecent.pop_back();
+      mEntries.erase(it);
+      mEvictions++;
+   }
+}
+
+//Drops a failed parse; a waiter will try the file itself
+void ParseCache::Abandon(std::unique_lock<std::mutex>& lock, const std::string& key)
+{
+   lock.lock();
+   mEntries.erase(key);
+   mParsed.notify_all();
+}
+
+//True if from, or a file it is waiting for, is waiting for to
+bool ParseCache::Reaches(const std::string& from, const std::string& to) const
+{
+   std::vector<std::string> pending(1, from);
+   std::map<std::string, bool> seen;
+   while(!pending.empty())
+   {
+      std::string current = pending.back();
+      pending.pop_back();
+      if(current == to)
+      {
+         return true;
+      }
+      if(seen[current])
+      {
+         continue;
+      }
+      seen[current] = true;
+
+      std::map<std::string, Entry>::const_iterator it = mEntries.find(current);
+      if(it != mEntries.end() && !it->second.result)
+      {
+         pending.insert(pending.end(), it->second.includes.begin(), it->second.includes.end());
+      }
+   }
+   return false;
+}
+
+}
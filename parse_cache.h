@@ -0,0 +1,91 @@
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+namespace SimpleConfig
+{
+
+class ConfigParser;
+
+typedef struct parseCacheStats
+{
+   unsigned long long hits;      //Served without parsing, including waits for another thread's parse
+   unsigned long long misses;    //Parsed by the caller
+   unsigned long long evictions;
+   size_t entries;
+   size_t bytes;                 //Estimated memory of the cached parses
+} ParseCacheStats;
+
+//Process-wide cache of parsed files, used for included fragments and
+//by callers that opt in instead of calling ConfigParser::Parse. A file
+//is identified by device, inode, size and modification time, so every
+//spelling of its path shares one entry and an edited file is parsed
+//again. When several threads ask for the same file at once, one parses
+//it and the others wait for the result.
+//
+//The estimated memory of the cached parses is kept under the capacity
+//by evicting the least recently used ones. Evicted results stay valid
+//for callers that still hold them.
+class ParseCache
+{
+   friend class ConfigParser;
+
+public:
+   static const size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+   explicit ParseCache(size_t capacity = DEFAULT_CAPACITY);
+   ~ParseCache();
+
+   static ParseCache& Global();
+
+   //Returns the parse of path, parsing it only if no unchanged copy is
+   //cached. The result is shared and must not be modified.
+   std::shared_ptr<const ConfigParser> Parse(const std::string& path);
+
+   //Evicts as needed to fit the new capacity
+   void SetCapacity(size_t capacity);
+   size_t Capacity() const;
+
+   ParseCacheStats Stats() const;
+   size_t Size() const;
+   void Clear();
+
+private:
+   ParseCache(const ParseCache&);
+   ParseCache& operator=(const ParseCache&);
+
+   typedef struct entry
+   {
+      std::shared_ptr<const ConfigParser> result; //NULL while being parsed
+      std::vector<std::string> includes;          //Files it waits for while parsed
+      std::list<std::string>::iterator recent;    //Position in mRecent once parsed
+      size_t bytes;
+   } Entry;
+
+   //parent is the key of the file containing the include, if any
+   std::shared_ptr<const ConfigParser> Acquire(const std::string& path, const std::string& parent);
+   void Abandon(std::unique_lock<std::mutex>& lock, const std::string& key);
+   bool Reaches(const std::string& from, const std::string& to) const;
+   void EvictToFit();
+
+   mutable std::mutex mMutex;
+   std::condition_variable mParsed;
+   std::map<std::string, Entry> mEntries;
+   std::list<std::string> mRecent; //Keys of parsed entries, most recently used first
+   size_t mCapacity;
+   size_t mBytes;
+   unsigned long long mHits;
+   unsigned long long mMisses;
+   unsigned long long mEvictions;
+};
+
+}
+
+#endif /* PARSE_CACHE_H */
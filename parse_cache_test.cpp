@@ -0,0 +1,202 @@
+#include "parse_cache.h"
+#include "config_parser.h"
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+class ParseCacheTest : public ::testing::Test
+{
+protected:
+
+   ParseCacheTest()
+   {
+      char dirTemplate[] = "/tmp/parse_cache_testXXXXXX";
+      dir = mkdtemp(dirTemplate);
+      dir += "/";
+   }
+
+   ~ParseCacheTest()
+   {
+      for(size_t i = files.size(); i > 0; i--)
+      {
+         remove(files[i-1].c_str());
+      }
+      rmdir(dir.c_str());
+   }
+
+   std::string WriteFile(const std::string& name, const std::string& text)
+   {
+      std::string path = dir + name;
+      std::string::size_type slash = name.rfind('/');
+      if(slash != std::string::npos)
+      {
+         std::string subdir = dir + name.substr(0, slash);
+         if(mkdir(subdir.c_str(), 0755) == 0)
+         {
+            files.insert(files.begin(), subdir);
+         }
+      }
+      std::ofstream file(path.c_str());
+      file << text;
+      files.push_back(path);
+      return path;
+   }
+
+   std::string dir;
+   std::vector<std::string> files;
+};
+
+TEST_F(ParseCacheTest, IncludeMergesAtTheDirective)
+{
+   WriteFile("common.ini", "a=10\nb=10\nc=10\n[Common]\nx=1\n");
+   std::string main = WriteFile("main.ini",
+      "a=1\ninclude \"common.ini\"\nb=2\n[S]\ninclude \"common.ini\"\ny=3\n");
+
+   SimpleConfig::ConfigParser c;
+   c.Parse(main);
+   EXPECT_EQ(10, c.LookupInteger("a"));
+   EXPECT_EQ(2, c.LookupInteger("b"));
+   EXPECT_EQ(10, c.LookupInteger("c"));
+   EXPECT_EQ(10, c.LookupInteger("S", "a"));
+   EXPECT_EQ(3, c.LookupInteger("S", "y"));
+   EXPECT_EQ(1, c.LookupInteger("Common", "x"));
+}
+
+TEST_F(ParseCacheTest, IncludesAreRelativeToTheIncludingFile)
+{
+   WriteFile("sub/leaf.ini", "leaf=\"found\"\nlevels=[1, 2]\n");
+   WriteFile("sub/mid.ini", "include \"leaf.ini\"\n");
+   std::string main = WriteFile("main.ini", "include \"sub/mid.ini\"\n");
+
+   SimpleConfig::ConfigParser c;
+   c.Parse(main);
+   EXPECT_EQ("found", c.LookupString("leaf"));
+   EXPECT_EQ(2u, c.LookupIntegerList("levels").size());
+}
+
+TEST_F(ParseCacheTest, ReferencesSeeIncludedValues)
+{
+   WriteFile("common.ini", "[Paths]\nroot=\"/srv\"\n");
+   std::string main = WriteFile("main.ini", "include \"common.ini\"\ndata=\"${Paths.root}/data\"\n");
+
+   SimpleConfig::ConfigParser c;
+   c.Parse(main);
+   EXPECT_EQ("/srv/data", c.LookupString("data"));
+}
+
+TEST_F(ParseCacheTest, UnchangedFileIsParsedOnce)
+{
+   std::string common = WriteFile("common.ini", "a=1\n");
+   SimpleConfig::ParseCache cache;
+
+   std::shared_ptr<const SimpleConfig::ConfigParser> first = cache.Parse(common);
+   std::shared_ptr<const SimpleConfig::ConfigParser> second = cache.Parse(dir + "./common.ini");
+   EXPECT_EQ(first.get(), second.get());
+   EXPECT_EQ(1u, cache.Size());
+
+   WriteFile("common.ini", "a=22\n");
+   std::shared_ptr<const SimpleConfig::ConfigParser> changed = cache.Parse(common);
+   EXPECT_NE(first.get(), changed.get());
+   EXPECT_EQ(22, changed->LookupInteger("a"));
+   EXPECT_EQ(1, first->LookupInteger("a"));
+}
+
+TEST_F(ParseCacheTest, CountsHitsAndMisses)
+{
+   std::string common = WriteFile("common.ini", "a=1\n");
+   SimpleConfig::ParseCache cache;
+   cache.Parse(common);
+   cache.Parse(common);
+
+   SimpleConfig::ParseCacheStats stats = cache.Stats();
+   EXPECT_EQ(1u, stats.hits);
+   EXPECT_EQ(1u, stats.misses);
+   EXPECT_EQ(1u, stats.entries);
+   EXPECT_LT(0u, stats.bytes);
+}
+
+TEST_F(ParseCacheTest, EvictsLeastRecentlyUsed)
+{
+   std::string a = WriteFile("a.ini", "x=1\n");
+   std::string b = WriteFile("b.ini", "x=2\n");
+   std::string c = WriteFile("c.ini", "x=3\n");
+   SimpleConfig::ParseCache cache;
+   cache.Parse(a);
+   cache.SetCapacity(2 * cache.Stats().bytes);
+
+   cache.Parse(b);
+   cache.Parse(a);
+   cache.Parse(c);
+   EXPECT_EQ(2u, cache.Size());
+   EXPECT_EQ(1u, cache.Stats().evictions);
+   EXPECT_GE(cache.Capacity(), cache.Stats().bytes);
+
+   cache.Parse(a);
+   EXPECT_EQ(2u, cache.Stats().hits);
+   cache.Parse(b);
+   EXPECT_EQ(4u, cache.Stats().misses);
+}
+
+TEST_F(ParseCacheTest, OversizedParseIsNotKept)
+{
+   std::string common = WriteFile("common.ini", "a=1\n");
+   SimpleConfig::ParseCache cache(0);
+   std::shared_ptr<const SimpleConfig::ConfigParser> parsed = cache.Parse(common);
+   EXPECT_EQ(1, parsed->LookupInteger("a"));
+   EXPECT_EQ(0u, cache.Size());
+   EXPECT_EQ(0u, cache.Stats().bytes);
+}
+
+TEST_F(ParseCacheTest, SharedFragmentIsCachedAcrossConfigs)
+{
+   std::string common = WriteFile("common.ini", "a=1\n");
+   std::string one = WriteFile("one.ini", "include \"common.ini\"\n");
+   std::string two = WriteFile("two.ini", "include \"common.ini\"\n");
+
+   SimpleConfig::ConfigParser first;
+   first.Parse(one);
+   std::shared_ptr<const SimpleConfig::ConfigParser> cached = SimpleConfig::ParseCache::Global().Parse(common);
+   SimpleConfig::ConfigParser second;
+   second.Parse(two);
+   EXPECT_EQ(cached.get(), SimpleConfig::ParseCache::Global().Parse(common).get());
+   EXPECT_EQ(1, second.LookupInteger("a"));
+}
+
+TEST_F(ParseCacheTest, IncludeCycleThrows)
+{
+   WriteFile("a.ini", "include \"b.ini\"\n");
+   WriteFile("b.ini", "include \"a.ini\"\n");
+   std::string self = WriteFile("self.ini", "include \"self.ini\"\n");
+
+   SimpleConfig::ConfigParser c;
+   EXPECT_THROW(c.Parse(dir + "a.ini"), std::runtime_error);
+   EXPECT_THROW(c.Parse(self), std::runtime_error);
+}
+
+TEST_F(ParseCacheTest, ErrorsInIncludedFilesThrow)
+{
+   WriteFile("bad.ini", "a=\n");
+   std::string missing = WriteFile("missing.ini", "include \"nonexistent.ini\"\n");
+   std::string bad = WriteFile("main.ini", "include \"bad.ini\"\n");
+
+   SimpleConfig::ConfigParser c;
+   EXPECT_THROW(c.Parse(missing), std::runtime_error);
+   EXPECT_THROW(c.Parse(bad), std::runtime_error);
+}
+
+TEST(IncludeTest, KeyNamedIncludeIsStillAnAssignment)
+{
+   std::istringstream configStream("include=5\n");
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   EXPECT_EQ(5, c.LookupInteger("include"));
+}
+
+}
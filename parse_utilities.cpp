@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <cerrno>
 #include <stdexcept>
+#include <cstdio>
 
 namespace SimpleConfig
 {
@@ -85,6 +86,37 @@ int Str2Int(const char *s, int base /* =0 */)
    return i;
 }
 
+long long Str2LongLong(std::string s, int base /* =0 */)
+{
+   return Str2LongLong(s.c_str(), base);
+}
+
+long long Str2LongLong(const char *s, int base /* =0 */)
+{
+   char *end;
+   errno = 0;
+   long long i = std::strtoll(s, &end, base);
+
+   if(errno == ERANGE)
+   {
+      std::string iStr(s);
+      errno = 0;
+      throw std::out_of_range(iStr + " out of range of long long");
+   }
+
+   if(*s == '\0')
+   {
+      throw std::invalid_argument("cannot convert empty string to long long");
+   }
+
+   if(*end != '\0')
+   {
+      std::string iStr(s);
+      throw std::invalid_argument("cannot convert " + iStr + " to long long");
+   }
+
+   return i;
+}
 
 double Str2Double(std::string s)
 {
@@ -139,4 +171,32 @@ bool Str2Bool(const char *s)
 {
    return Str2Bool(std::string(s));
 }
+
+std::string LongLong2Str(long long i)
+{
+   char buf[NUMBER_TEXT_SIZE];
+   return std::string(buf, LongLong2Str(i, buf));
+}
+
+std::string Double2Str(double d)
+{
+   char buf[NUMBER_TEXT_SIZE];
+   return std::string(buf, Double2Str(d, buf));
+}
+
+size_t LongLong2Str(long long i, char* buf)
+{
+   return snprintf(buf, NUMBER_TEXT_SIZE, "%lld", i);
+}
+
+size_t Double2Str(double d, char* buf)
+{
+   int length = snprintf(buf, NUMBER_TEXT_SIZE, "%.15g", d);
+   if(std::strtod(buf, NULL) != d)
+   {
+      length = snprintf(buf, NUMBER_TEXT_SIZE, "%.17g", d);
+   }
+   return length;
+}
+
 }
@@ -22,12 +22,25 @@ std::string ToUppered(std::string s);
 int Str2Int(std::string s, int base = 0);
 int Str2Int(const char *s, int base = 0);
 
+long long Str2LongLong(std::string s, int base = 0);
+long long Str2LongLong(const char *s, int base = 0);
+
 double Str2Double(std::string s);
 double Str2Double(const char *s);
 
 bool Str2Bool(std::string s);
 bool Str2Bool(const char *s);
 
+//Shortest text that converts back to the same value
+std::string LongLong2Str(long long i);
+std::string Double2Str(double d);
+
+//The same written to buf, which needs NUMBER_TEXT_SIZE bytes. Returns
+//the length of the text.
+const size_t NUMBER_TEXT_SIZE = 32;
+size_t LongLong2Str(long long i, char* buf);
+size_t Double2Str(double d, char* buf);
+
 }
 
 
@@ -242,6 +242,32 @@ TEST(Str2IntTest, Str2IntWorks)
    EXPECT_EQ(SimpleConfig::Str2Int(testString, 2), 9);
 }
 
+TEST(Str2LongLongTest, OutOfRange)
+{
+   std::string testString = "100000000000000000000";
+   EXPECT_THROW(SimpleConfig::Str2LongLong(testString), std::out_of_range);
+}
+
+TEST(Str2LongLongTest, UnexpectedForm)
+{
+   EXPECT_THROW(SimpleConfig::Str2LongLong(""), std::invalid_argument);
+   EXPECT_THROW(SimpleConfig::Str2LongLong("12x"), std::invalid_argument);
+}
+
+TEST(Str2LongLongTest, Str2LongLongWorks)
+{
+   EXPECT_EQ(SimpleConfig::Str2LongLong("4000000000"), 4000000000LL);
+   EXPECT_EQ(SimpleConfig::Str2LongLong("-0x10"), -16);
+}
+
+TEST(Number2StrTest, Number2StrWorks)
+{
+   EXPECT_EQ("-4000000000", SimpleConfig::LongLong2Str(-4000000000LL));
+   EXPECT_EQ("2.5", SimpleConfig::Double2Str(2.5));
+   EXPECT_EQ("-3.3", SimpleConfig::Double2Str(-3.3));
+   EXPECT_EQ(0.1 + 0.2, SimpleConfig::Str2Double(SimpleConfig::Double2Str(0.1 + 0.2)));
+}
+
 TEST(Str2DoubleTest, OutOfRange)
 {
    std::string testString = "100e1000000";
@@ -0,0 +1,207 @@
+#include "perf_counters.h"
+#include "config_parser.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace SimpleConfig
+{
+
+static std::atomic<unsigned long long> allocationCount(0);
+
+static const unsigned long long counterConfigs[PERF_COUNTER_COUNT] =
+{
+   PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+};
+
+static const char* counterNames[PERF_COUNTER_COUNT] =
+{
+   "cycles", "instructions", "branch_misses", "cache_misses"
+};
+
+//User space only, so that a perf_event_paranoid of 2 still allows it
+static int OpenCounter(unsigned long long config)
+{
+   struct perf_event_attr attr;
+   std::memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = PERF_TYPE_HARDWARE;
+   attr.config = config;
+   attr.disabled = 1;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+   return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static double Now()
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+PerfCounters::PerfCounters():
+   mStartAllocations(0), mStartSeconds(0)
+{
+   for(int i = 0; i < PERF_COUNTER_COUNT; i++)
+   {
+      mFds[i] = OpenCounter(counterConfigs[i]);
+   }
+}
+
+PerfCounters::~PerfCounters()
+{
+   for(int i = 0; i < PERF_COUNTER_COUNT; i++)
+   {
+      if(mFds[i] >= 0)
+      {
+         close(mFds[i]);
+      }
+   }
+}
+
+bool PerfCounters::Available(PerfCounter counter) const
+{
+   return mFds[counter] >= 0;
+}
+
+const char* PerfCounters::Name(PerfCounter counter)
+{
+   return counterNames[counter];
+}
+
+void PerfCounters::Start()
+{
+   for(int i = 0; i < PERF_COUNTER_COUNT; i++)
+   {
+      if(mFds[i] >= 0)
+      {
+         ioctl(mFds[i], PERF_EVENT_IOC_RESET, 0);
+      }
+   }
+   mStartAllocations = allocationCount.load(std::memory_order_relaxed);
+   mStartSeconds = Now();
+   for(int i = 0; i < PERF_COUNTER_COUNT; i++)
+   {
+      if(mFds[i] >= 0)
+      {
+         ioctl(mFds[i], PERF_EVENT_IOC_ENABLE, 0);
+      }
+   }
+}
+
+//Counts are scaled up when the kernel had to share the hardware
+//counters with other events and only ran ours part of the time
+PerfSample PerfCounters::Stop()
+{
+   for(int i = 0; i < PERF_COUNTER_COUNT; i++)
+   {
+      if(mFds[i] >= 0)
+      {
+         ioctl(mFds[i], PERF_EVENT_IOC_DISABLE, 0);
+      }
+   }
+
+   PerfSample sample;
+   sample.seconds = Now() - mStartSeconds;
+   sample.allocations = allocationCount.load(std::memory_order_relaxed) - mStartAllocations;
+   for(int i = 0; i < PERF_COUNTER_COUNT; i++)
+   {
+      sample.counts[i] = 0;
+      sample.valid[i] = false;
+
+      unsigned long long values[3]; //Count, time enabled, time running
+      if(mFds[i] >= 0 && read(mFds[i], values, sizeof(values)) == static_cast<ssize_t>(sizeof(values)) && values[2] > 0)
+      {
+         sample.counts[i] = static_cast<double>(values[0]) * values[1] / values[2];
+         sample.valid[i] = true;
+      }
+   }
+   return sample;
+}
+
+void PerfCounters::CountAllocation()
+{
+   allocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+PerfResults LoadPerfBaseline(const std::string& path)
+{
+   ConfigParser baseline;
+   baseline.Parse(path);
+
+   PerfResults results;
+   ConfigParser::SectionRange phases = baseline.Sections();
+   for(ConfigParser::SectionRange::const_iterator phaseIt = phases.begin(); phaseIt != phases.end(); ++phaseIt)
+   {
+      ConfigParser::KeyRange metrics = baseline.Keys(*phaseIt);
+      for(ConfigParser::KeyRange::const_iterator metricIt = metrics.begin(); metricIt != metrics.end(); ++metricIt)
+      {
+         results[*phaseIt][*metricIt] = baseline.LookupDouble(*phaseIt, *metricIt);
+      }
+   }
+   return results;
+}
+
+void SavePerfBaseline(const PerfResults& results, const std::string& path)
+{
+   std::ofstream out(path.c_str());
+   if(!out.is_open())
+   {
+      throw std::runtime_error("Could not open file " + path);
+   }
+
+   out << "# Per input byte (scan, parse, reparse, validate) or per lookup (lookup) costs\n";
+   for(PerfResults::const_iterator phaseIt = results.begin(); phaseIt != results.end(); ++phaseIt)
+   {
+      out << "\n[" << phaseIt->first << "]\n";
+      for(std::map<std::string, double>::const_iterator metricIt = phaseIt->second.begin(); metricIt != phaseIt->second.end(); ++metricIt)
+      {
+         //Fixed notation: the lexer reads no signed exponents
+         char value[64];
+         std::snprintf(value, sizeof(value), "%.6f", metricIt->second);
+         out << metricIt->first << " = " << value << "\n";
+      }
+   }
+   if(!out)
+   {
+      throw std::runtime_error("Could not write file " + path);
+   }
+}
+
+std::map<std::string, double> PerfRegressions(const PerfResults& baseline, const PerfResults& current, double tolerance)
+{
+   std::map<std::string, double> regressions;
+   for(PerfResults::const_iterator phaseIt = current.begin(); phaseIt != current.end(); ++phaseIt)
+   {
+      PerfResults::const_iterator basePhase = baseline.find(phaseIt->first);
+      if(basePhase == baseline.end())
+      {
+         continue;
+      }
+      for(std::map<std::string, double>::const_iterator metricIt = phaseIt->second.begin(); metricIt != phaseIt->second.end(); ++metricIt)
+      {
+         std::map<std::string, double>::const_iterator baseMetric = basePhase->second.find(metricIt->first);
+         if(baseMetric == basePhase->second.end())
+         {
+            continue;
+         }
+         double growth = (baseMetric->second > 0) ? metricIt->second / baseMetric->second - 1 : (metricIt->second > 0 ? 1 : 0);
+         if(growth > tolerance)
+         {
+            regressions[phaseIt->first + "." + metricIt->first] = growth;
+         }
+      }
+   }
+   return regressions;
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <string>
+#include <map>
+
+namespace SimpleConfig
+{
+
+typedef enum perfCounter
+{
+   CPU_CYCLES, INSTRUCTIONS, BRANCH_MISSES, CACHE_MISSES,
+   PERF_COUNTER_COUNT
+} PerfCounter;
+
+typedef struct perfSample
+{
+   double counts[PERF_COUNTER_COUNT];
+   bool valid[PERF_COUNTER_COUNT]; //False if the counter could not be read
+   unsigned long long allocations;
+   double seconds;
+} PerfSample;
+
+//Hardware counters of the calling thread, read through perf_event_open.
+//Counters the kernel refuses (no PMU in a container or VM, or a strict
+//perf_event_paranoid setting) are reported as not valid rather than
+//failing; wall time and allocations are always measured.
+class PerfCounters
+{
+public:
+   PerfCounters();
+   ~PerfCounters();
+
+   bool Available(PerfCounter counter) const;
+   static const char* Name(PerfCounter counter);
+
+   void Start();
+   PerfSample Stop();
+
+   //Allocations are only seen by programs whose operator new calls this
+   static void CountAllocation();
+
+private:
+   PerfCounters(const PerfCounters&);
+   PerfCounters& operator=(const PerfCounters&);
+
+   int mFds[PERF_COUNTER_COUNT];
+   unsigned long long mStartAllocations;
+   double mStartSeconds;
+};
+
+
+//Per unit results of a run, by phase then metric (e.g. "parse",
+//"instructions"). Baselines are stored as config files in the same shape.
+typedef std::map<std::string, std::map<std::string, double> > PerfResults;
+
+PerfResults LoadPerfBaseline(const std::string& path);
+void SavePerfBaseline(const PerfResults& results, const std::string& path);
+
+//Metrics of current that grew by more than tolerance (0.1 is 10%) over
+//baseline, by "phase.metric", with their growth. Metrics missing from
+//either side are skipped.
+std::map<std::string, double> PerfRegressions(const PerfResults& baseline, const PerfResults& current, double tolerance);
+
+}
+
+#endif /* PERF_COUNTERS_H */
@@ -0,0 +1,87 @@
+#include "perf_counters.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <unistd.h>
+
+namespace
+{
+
+//Containers usually have no PMU; either way nothing may fail
+TEST(PerfCountersTest, UnavailableCountersAreNotValid)
+{
+   SimpleConfig::PerfCounters counters;
+   counters.Start();
+   volatile double x = 1;
+   for(int i = 0; i < 100000; i++)
+   {
+      x = x * 1.000001;
+   }
+   SimpleConfig::PerfSample sample = counters.Stop();
+
+   for(int i = 0; i < SimpleConfig::PERF_COUNTER_COUNT; i++)
+   {
+      SimpleConfig::PerfCounter counter = static_cast<SimpleConfig::PerfCounter>(i);
+      if(!counters.Available(counter))
+      {
+         EXPECT_FALSE(sample.valid[i]);
+      }
+      if(sample.valid[i])
+      {
+         EXPECT_GE(sample.counts[i], 0);
+      }
+   }
+   EXPECT_GT(sample.seconds, 0);
+   EXPECT_STREQ("instructions", SimpleConfig::PerfCounters::Name(SimpleConfig::INSTRUCTIONS));
+}
+
+TEST(PerfCountersTest, AllocationsCountedBetweenStartAndStop)
+{
+   SimpleConfig::PerfCounters counters;
+   SimpleConfig::PerfCounters::CountAllocation();
+   counters.Start();
+   SimpleConfig::PerfCounters::CountAllocation();
+   SimpleConfig::PerfCounters::CountAllocation();
+   EXPECT_EQ(2u, counters.Stop().allocations);
+}
+
+TEST(PerfCountersTest, BaselineRoundTrips)
+{
+   SimpleConfig::PerfResults results;
+   results["parse"]["instructions"] = 41.25;
+   results["parse"]["allocations"] = 0.625;
+   results["lookup"]["cycles"] = 180;
+
+   char path[] = "/tmp/perf_baseline_XXXXXX";
+   int fd = mkstemp(path);
+   ASSERT_GE(fd, 0);
+   close(fd);
+   SimpleConfig::SavePerfBaseline(results, path);
+   SimpleConfig::PerfResults loaded = SimpleConfig::LoadPerfBaseline(path);
+   std::remove(path);
+
+   ASSERT_EQ(2u, loaded.size());
+   EXPECT_DOUBLE_EQ(41.25, loaded["parse"]["instructions"]);
+   EXPECT_DOUBLE_EQ(0.625, loaded["parse"]["allocations"]);
+   EXPECT_DOUBLE_EQ(180, loaded["lookup"]["cycles"]);
+}
+
+TEST(PerfCountersTest, RegressionsBeyondToleranceReported)
+{
+   SimpleConfig::PerfResults baseline;
+   baseline["parse"]["instructions"] = 100;
+   baseline["parse"]["cycles"] = 100;
+   baseline["scan"]["allocations"] = 0;
+
+   SimpleConfig::PerfResults current;
+   current["parse"]["instructions"] = 125;
+   current["parse"]["cycles"] = 105;
+   current["parse"]["cache_misses"] = 3;
+   current["scan"]["allocations"] = 0;
+   current["lookup"]["cycles"] = 400;
+
+   std::map<std::string, double> regressions = SimpleConfig::PerfRegressions(baseline, current, 0.10);
+   ASSERT_EQ(1u, regressions.size());
+   EXPECT_DOUBLE_EQ(0.25, regressions["parse.instructions"]);
+}
+
+}
@@ -0,0 +1,369 @@
+#include "perf_counters.h"
+#include "config_parser.h"
+#include "config_lexer.h"
+#include "config_schema.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Usage: perf_harness [--baseline file] [--write-baseline file] [--tolerance percent]
+//Measures the lexer, the parser (fresh, and reset for a reload),
+//schema validation and lookups over a fixed corpus and reports hardware counters, allocations
+//and time per input byte or per lookup. With --baseline, exits with 1 if a metric regressed by more
+//than the tolerance (default 10%).
+
+//Every allocation made by the measured code goes through here
+void* operator new(size_t size)
+{
+   SimpleConfig::PerfCounters::CountAllocation();
+   void* p = std::malloc(size ? size : 1);
+   if(!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void operator delete(void* p) noexcept
+{
+   std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+   std::free(p);
+}
+
+namespace
+{
+
+const int SECTIONS = 200;
+const int KEYS = 50;
+const int RUNS = 5;
+
+//Keeps lookup results alive so they are not optimized away
+volatile long long lookupSink;
+
+bool EndsWith(const std::string& text, const std::string& suffix)
+{
+   return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//Same text on every run and machine, so results stay comparable
+std::string Corpus()
+{
+   std::ostringstream out;
+   out << "# perf_harness corpus\n";
+   for(int s = 0; s < SECTIONS; s++)
+   {
+      out << "[section_" << s << "]\n";
+      for(int k = 0; k < KEYS; k++)
+      {
+         switch(k % 5)
+         {
+         case 0:
+            out << "key_" << k << " = " << s * 1000 + k << "  # integer\n";
+            break;
+         case 1:
+            out << "key_" << k << " = " << k << ".5\n";
+            break;
+         case 2:
+            out << "key_" << k << " = \"/srv/app/" << s << "/data_" << k << ".bin\"\n";
+            break;
+         case 3:
+            out << "key_" << k << " = " << ((s + k) % 2 ? "true" : "false") << "\n";
+            break;
+         default:
+            out << "key_" << k << " = [1, 2, 3, " << k << "]\n";
+            break;
+         }
+      }
+   }
+   return out.str();
+}
+
+//Names every key of the corpus with its type, and bounds the integers
+std::string CorpusSchema()
+{
+   const char* types[] = {"integer", "real", "string", "bool", "list"};
+   std::ostringstream out;
+   for(int s = 0; s < SECTIONS; s++)
+   {
+      for(int k = 0; k < KEYS; k++)
+      {
+         out << "[section_" << s << ".key_" << k << "]\n";
+         out << "type = \"" << types[k % 5] << "\"\n";
+         out << "required = true\n";
+         if(k % 5 == 0)
+         {
+            out << "min = 0\nmax = " << SECTIONS * 1000 << "\n";
+         }
+      }
+   }
+   return out.str();
+}
+
+std::vector<std::pair<std::string, std::string> > LookupKeys()
+{
+   std::vector<std::pair<std::string, std::string> > keys;
+   for(int s = 0; s < SECTIONS; s++)
+   {
+      std::ostringstream section;
+      section << "section_" << s;
+      for(int k = 0; k < KEYS; k += 5)
+      {
+         std::ostringstream key;
+         key << "key_" << k;
+         keys.push_back(std::make_pair(section.str(), key.str()));
+      }
+   }
+   return keys;
+}
+
+//Least of each metric over the runs, per unit of work
+template<typename Work>
+std::map<std::string, double> Measure(SimpleConfig::PerfCounters& counters, Work work, double units)
+{
+   std::map<std::string, double> best;
+   for(int run = 0; run < RUNS; run++)
+   {
+      counters.Start();
+      work();
+      SimpleConfig::PerfSample sample = counters.Stop();
+
+      std::map<std::string, double> perUnit;
+      for(int i = 0; i < SimpleConfig::PERF_COUNTER_COUNT; i++)
+      {
+         if(sample.valid[i])
+         {
+            perUnit[SimpleConfig::PerfCounters::Name(static_cast<SimpleConfig::PerfCounter>(i))] = sample.counts[i] / units;
+         }
+      }
+      perUnit["allocations"] = sample.allocations / units;
+      perUnit["nanoseconds"] = sample.seconds * 1e9 / units;
+
+      for(std::map<std::string, double>::const_iterator it = perUnit.begin(); it != perUnit.end(); ++it)
+      {
+         if(run == 0 || it->second < best[it->first])
+         {
+            best[it->first] = it->second;
+         }
+      }
+   }
+   return best;
+}
+
+class ScanWork
+{
+public:
+   explicit ScanWork(const std::string& text): mText(text) {}
+   void operator()() const
+   {
+      std::istringstream source(mText);
+      SimpleConfig::ConfigLexer lexer;
+      lexer.Scan(source);
+   }
+
+private:
+   const std::string& mText;
+};
+
+class ParseWork
+{
+public:
+   explicit ParseWork(const std::string& text): mText(text) {}
+   void operator()() const
+   {
+      SimpleConfig::ConfigParser parser;
+      parser.Parse(mText.data(), mText.size());
+   }
+
+private:
+   const std::string& mText;
+};
+
+//Steady-state reload: the parser keeps its storage between runs
+class ReparseWork
+{
+public:
+   ReparseWork(SimpleConfig::ConfigParser& parser, const std::string& text): mParser(parser), mText(text) {}
+   void operator()() const
+   {
+      mParser.Reset();
+      mParser.Parse(mText.data(), mText.size());
+   }
+
+private:
+   SimpleConfig::ConfigParser& mParser;
+   const std::string& mText;
+};
+
+class ValidateWork
+{
+public:
+   ValidateWork(const SimpleConfig::ConfigSchema& schema, const SimpleConfig::ConfigParser& config):
+      mSchema(schema), mConfig(config) {}
+   void operator()() const
+   {
+      if(!mSchema.Validate(mConfig).empty())
+      {
+         throw std::logic_error("perf_harness corpus does not match its schema");
+      }
+   }
+
+private:
+   const SimpleConfig::ConfigSchema& mSchema;
+   const SimpleConfig::ConfigParser& mConfig;
+};
+
+class LookupWork
+{
+public:
+   LookupWork(const SimpleConfig::ConfigParser& config, const std::vector<std::pair<std::string, std::string> >& keys):
+      mConfig(config), mKeys(keys) {}
+   void operator()() const
+   {
+      long long sum = 0;
+      for(size_t i = 0; i < mKeys.size(); i++)
+      {
+         sum += mConfig.LookupInteger(mKeys[i].first, mKeys[i].second);
+      }
+      lookupSink = sum;
+   }
+
+private:
+   const SimpleConfig::ConfigParser& mConfig;
+   const std::vector<std::pair<std::string, std::string> >& mKeys;
+};
+
+void Print(const SimpleConfig::PerfResults& results, const SimpleConfig::PerfResults& baseline)
+{
+   std::printf("%-8s %-14s %14s %14s %9s\n", "phase", "metric", "value", "baseline", "change");
+   for(SimpleConfig::PerfResults::const_iterator phaseIt = results.begin(); phaseIt != results.end(); ++phaseIt)
+   {
+      for(std::map<std::string, double>::const_iterator metricIt = phaseIt->second.begin(); metricIt != phaseIt->second.end(); ++metricIt)
+      {
+         std::printf("%-8s %-14s %14.4f", phaseIt->first.c_str(), metricIt->first.c_str(), metricIt->second);
+
+         SimpleConfig::PerfResults::const_iterator basePhase = baseline.find(phaseIt->first);
+         if(basePhase != baseline.end() && basePhase->second.count(metricIt->first))
+         {
+            double base = basePhase->second.find(metricIt->first)->second;
+            std::printf(" %14.4f", base);
+            if(base > 0)
+            {
+               std::printf(" %+8.1f%%", (metricIt->second / base - 1) * 100);
+            }
+         }
+         std::printf("\n");
+      }
+   }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+   std::string baselinePath;
+   std::string writePath;
+   double tolerance = 0.10;
+   for(int i = 1; i < argc; i++)
+   {
+      if(std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+      {
+         baselinePath = argv[++i];
+      }
+      else if(std::strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc)
+      {
+         writePath = argv[++i];
+      }
+      else if(std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+      {
+         tolerance = std::atof(argv[++i]) / 100;
+      }
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--baseline file] [--write-baseline file] [--tolerance percent]" << std::endl;
+         return 2;
+      }
+   }
+
+   SimpleConfig::PerfCounters counters;
+   bool anyCounter = false;
+   for(int i = 0; i < SimpleConfig::PERF_COUNTER_COUNT; i++)
+   {
+      SimpleConfig::PerfCounter counter = static_cast<SimpleConfig::PerfCounter>(i);
+      if(counters.Available(counter))
+      {
+         anyCounter = true;
+      }
+      else
+      {
+         std::cerr << "note: " << SimpleConfig::PerfCounters::Name(counter) << " not available, skipped" << std::endl;
+      }
+   }
+   if(!anyCounter)
+   {
+      std::cerr << "note: no hardware counters; reporting allocations and time only" << std::endl;
+   }
+
+   std::string corpus = Corpus();
+   SimpleConfig::ConfigParser config;
+   config.Parse(corpus.data(), corpus.size());
+   std::vector<std::pair<std::string, std::string> > keys = LookupKeys();
+
+   SimpleConfig::PerfResults results;
+   results["scan"] = Measure(counters, ScanWork(corpus), corpus.size());
+   results["parse"] = Measure(counters, ParseWork(corpus), corpus.size());
+   SimpleConfig::ConfigParser reloaded;
+   reloaded.Parse(corpus.data(), corpus.size());
+   results["reparse"] = Measure(counters, ReparseWork(reloaded, corpus), corpus.size());
+   std::string schemaText = CorpusSchema();
+   SimpleConfig::ConfigParser schemaConfig;
+   schemaConfig.Parse(schemaText.data(), schemaText.size());
+   SimpleConfig::ConfigSchema schema(schemaConfig);
+   results["validate"] = Measure(counters, ValidateWork(schema, config), corpus.size());
+   results["lookup"] = Measure(counters, LookupWork(config, keys), keys.size());
+
+   std::printf("corpus: %lu bytes, %lu lookups; scan, parses and validate per byte, lookup per lookup\n",
+      static_cast<unsigned long>(corpus.size()), static_cast<unsigned long>(keys.size()));
+
+   SimpleConfig::PerfResults baseline;
+   int status = 0;
+   if(!baselinePath.empty())
+   {
+      try
+      {
+         baseline = SimpleConfig::LoadPerfBaseline(baselinePath);
+      }
+      catch(std::exception& e)
+      {
+         std::cerr << "note: no baseline loaded (" << e.what() << ")" << std::endl;
+      }
+   }
+   Print(results, baseline);
+
+   //Wall time is too noisy to fail a run on
+   std::map<std::string, double> regressions = SimpleConfig::PerfRegressions(baseline, results, tolerance);
+   for(std::map<std::string, double>::const_iterator it = regressions.begin(); it != regressions.end(); ++it)
+   {
+      if(EndsWith(it->first, ".nanoseconds"))
+      {
+         continue;
+      }
+      std::printf("REGRESSION %s %+.1f%%\n", it->first.c_str(), it->second * 100);
+      status = 1;
+   }
+
+   if(!writePath.empty())
+   {
+      SimpleConfig::SavePerfBaseline(results, writePath);
+   }
+   return status;
+}
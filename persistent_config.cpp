@@ -0,0 +1,331 @@
+#include "persistent_config.h"
+#include <map>
+
+namespace SimpleConfig
+{
+
+typedef ConfigParser::KeyIndex KeyMap;
+
+static const unsigned int BITS_PER_LEVEL = 5;
+static const unsigned int LEVELS = 13; //Enough to use all 64 bits of the hash
+
+static unsigned int Fragment(unsigned long long hash, unsigned int level)
+{
+   return static_cast<unsigned int>(hash >> (level * BITS_PER_LEVEL)) & 31;
+}
+
+//Slot position of fragment among the set bits below it
+static size_t Position(unsigned int bitmap, unsigned int fragment)
+{
+   return __builtin_popcount(bitmap & ((1u << fragment) - 1));
+}
+
+
+PersistentConfig::PersistentConfig():
+   mSize(0)
+{}
+
+PersistentConfig::PersistentConfig(const ConfigParser& config):
+   mSize(0)
+{
+   std::map<std::string, const KeyMap*> sections;
+   config.VisibleSections(sections);
+   for(std::map<std::string, const KeyMap*>::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      for(KeyMap::const_iterator keyIt = sectionIt->second->begin(); keyIt != sectionIt->second->end(); ++keyIt)
+      {
+         std::shared_ptr<Entry> entry(new Entry());
+         entry->hash = Hash(sectionIt->first, keyIt->first);
+         entry->section = sectionIt->first;
+         entry->key = keyIt->first;
+         entry->value = config.mValues.Get(keyIt->second);
+
+         bool added = false;
+         mRoot = Insert(mRoot, 0, entry, added);
+         if(added)
+         {
+            mSize++;
+         }
+      }
+   }
+}
+
+PersistentConfig::PersistentConfig(const NodePtr& root, size_t size):
+   mRoot(root), mSize(size)
+{}
+
+PersistentConfig::~PersistentConfig()
+{}
+
+PersistentConfig PersistentConfig::Set(const std::string& section, const std::string& key, const Token& value) const
+{
+   std::shared_ptr<Entry> entry(new Entry());
+   entry->hash = Hash(section, key);
+   entry->section = section;
+   entry->key = key;
+   entry->value = value;
+
+   bool added = false;
+   NodePtr root = Insert(mRoot, 0, entry, added);
+   return PersistentConfig(root, added ? mSize + 1 : mSize);
+}
+
+PersistentConfig PersistentConfig::Erase(const std::string& section, const std::string& key) const
+{
+   if(!mRoot)
+   {
+      return *this;
+   }
+   bool removed = false;
+   NodePtr root = Remove(mRoot, 0, Hash(section, key), section, key, removed);
+   return PersistentConfig(root, removed ? mSize - 1 : mSize);
+}
+
+size_t PersistentConfig::Size() const
+{
+   return mSize;
+}
+
+bool PersistentConfig::Contains(const std::string& section, const std::string& key) const
+{
+   Token value;
+   return Find(section, key, value);
+}
+
+bool PersistentConfig::Find(const std::string& section, const std::string& key, Token& value) const
+{
+   unsigned long long hash = Hash(section, key);
+   const Node* node = mRoot.get();
+   for(unsigned int level = 0; node; level++)
+   {
+      if(level >= LEVELS)
+      {
+         for(size_t i = 0; i < node->collided.size(); i++)
+         {
+            if(Matches(*node->collided[i], hash, section, key))
+            {
+               value = node->collided[i]->value;
+               return true;
+            }
+         }
+         return false;
+      }
+
+      unsigned int fragment = Fragment(hash, level);
+      if(!(node->bitmap & (1u << fragment)))
+      {
+         return false;
+      }
+      const Slot& slot = node->slots[Position(node->bitmap, fragment)];
+      if(slot.entry)
+      {
+         if(Matches(*slot.entry, hash, section, key))
+         {
+            value = slot.entry->value;
+            return true;
+         }
+         return false;
+      }
+      node = slot.child.get();
+   }
+   return false;
+}
+
+//64 bit FNV-1a of section, a separator and key
+unsigned long long PersistentConfig::Hash(const std::string& section, const std::string& key)
+{
+   unsigned long long hash = 14695981039346656037ULL;
+   for(size_t i = 0; i < section.size(); i++)
+   {
+      hash = (hash ^ static_cast<unsigned char>(section[i])) * 1099511628211ULL;
+   }
+   hash = hash * 1099511628211ULL;
+   for(size_t i = 0; i < key.size(); i++)
+   {
+      hash = (hash ^ static_cast<unsigned char>(key[i])) * 1099511628211ULL;
+   }
+   return hash;
+}
+
+bool PersistentConfig::Matches(const Entry& entry, unsigned long long hash, const std::string& section, const std::string& key)
+{
+   return entry.hash == hash && entry.key == key && entry.section == section;
+}
+
+//Returns a copy of node with entry added, copying only the nodes on
+//the path to it
+PersistentConfig::NodePtr PersistentConfig::Insert(const NodePtr& node, unsigned int level, const EntryPtr& entry, bool& added)
+{
+   std::shared_ptr<Node> copy(node ? new Node(*node) : new Node());
+   if(!node)
+   {
+      copy->bitmap = 0;
+   }
+
+   if(level >= LEVELS)
+   {
+      for(size_t i = 0; i < copy->collided.size(); i++)
+      {
+         if(Matches(*copy->collided[i], entry->hash, entry->section, entry->key))
+         {
+            copy->collided[i] = entry;
+            return copy;
+         }
+      }
+      copy->collided.push_back(entry);
+      added = true;
+      return copy;
+   }
+
+   unsigned int fragment = Fragment(entry->hash, level);
+   size_t position = Position(copy->bitmap, fragment);
+   if(!(copy->bitmap & (1u << fragment)))
+   {
+      Slot slot;
+      slot.entry = entry;
+      copy->slots.insert(copy->slots.begin() + position, slot);
+      copy->bitmap |= 1u << fragment;
+      added = true;
+      return copy;
+   }
+
+   Slot& slot = copy->slots[position];
+   if(slot.child)
+   {
+      slot.child = Insert(slot.child, level + 1, entry, added);
+   }
+   else if(Matches(*slot.entry, entry->hash, entry->section, entry->key))
+   {
+      slot.entry = entry;
+   }
+   else
+   {
+      slot.child = Pair(slot.entry, entry, level + 1);
+      slot.entry.reset();
+      added = true;
+   }
+   return copy;
+}
+
+//Returns node without the entry, node itself if it has no such entry,
+//or NULL if nothing is left
+PersistentConfig::NodePtr PersistentConfig::Remove(const NodePtr& node, unsigned int level, unsigned long long hash,
+   const std::string& section, const std::string& key, bool& removed)
+{
+   if(level >= LEVELS)
+   {
+      for(size_t i = 0; i < node->collided.size(); i++)
+      {
+         if(Matches(*node->collided[i], hash, section, key))
+         {
+            removed = true;
+            if(node->collided.size() == 1)
+            {
+               return NodePtr();
+            }
+            std::shared_ptr<Node> copy(new Node(*node));
+            copy->collided.erase(copy->collided.begin() + i);
+            return copy;
+         }
+      }
+      return node;
+   }
+
+   unsigned int fragment = Fragment(hash, level);
+   if(!(node->bitmap & (1u << fragment)))
+   {
+      return node;
+   }
+   size_t position = Position(node->bitmap, fragment);
+   const Slot& slot = node->slots[position];
+
+   NodePtr child;
+   if(slot.entry)
+   {
+      if(!Matches(*slot.entry, hash, section, key))
+      {
+         return node;
+      }
+   }
+   else
+   {
+      child = Remove(slot.child, level + 1, hash, section, key, removed);
+      if(child == slot.child)
+      {
+         return node;
+      }
+   }
+   removed = true;
+
+   std::shared_ptr<Node> copy(new Node(*node));
+   EntryPtr only = child ? OnlyEntry(child) : EntryPtr();
+   if(only)
+   {
+      //Keep the trie as shallow as if the removed key was never there
+      copy->slots[position].entry = only;
+      copy->slots[position].child.reset();
+   }
+   else if(child)
+   {
+      copy->slots[position].child = child;
+   }
+   else
+   {
+      copy->slots.erase(copy->slots.begin() + position);
+      copy->bitmap &= ~(1u << fragment);
+      if(copy->slots.empty())
+      {
+         return NodePtr();
+      }
+   }
+   return copy;
+}
+
+//Node at level holding two entries whose hashes agree on all earlier levels
+PersistentConfig::NodePtr PersistentConfig::Pair(const EntryPtr& a, const EntryPtr& b, unsigned int level)
+{
+   std::shared_ptr<Node> pair(new Node());
+   pair->bitmap = 0;
+   if(level >= LEVELS)
+   {
+      pair->collided.push_back(a);
+      pair->collided.push_back(b);
+      return pair;
+   }
+
+   unsigned int fragmentA = Fragment(a->hash, level);
+   unsigned int fragmentB = Fragment(b->hash, level);
+   if(fragmentA == fragmentB)
+   {
+      Slot slot;
+      slot.child = Pair(a, b, level + 1);
+      pair->slots.push_back(slot);
+      pair->bitmap = 1u << fragmentA;
+      return pair;
+   }
+
+   Slot first;
+   Slot second;
+   first.entry = fragmentA < fragmentB ? a : b;
+   second.entry = fragmentA < fragmentB ? b : a;
+   pair->slots.push_back(first);
+   pair->slots.push_back(second);
+   pair->bitmap = (1u << fragmentA) | (1u << fragmentB);
+   return pair;
+}
+
+//The entry of a node that holds nothing else, or NULL
+PersistentConfig::EntryPtr PersistentConfig::OnlyEntry(const NodePtr& node)
+{
+   if(node->slots.size() == 1 && node->slots[0].entry && node->collided.empty())
+   {
+      return node->slots[0].entry;
+   }
+   if(node->slots.empty() && node->collided.size() == 1)
+   {
+      return node->collided[0];
+   }
+   return EntryPtr();
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef PERSISTENT_CONFIG_H
+#define PERSISTENT_CONFIG_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "config_source.h"
+#include "config_parser.h"
+
+namespace SimpleConfig
+{
+
+//An immutable config that can be edited. Set and Erase leave the
+//config they are called on untouched and return a new version that
+//shares every unchanged part with it, so older versions stay valid
+//for readers, audits and rollback.
+//
+//Keys live in a hash array mapped trie: each level uses five bits of
+//the key's hash to pick one of up to 32 children, and only the nodes
+//on the path to the edited key are copied. Copying a PersistentConfig
+//(a snapshot) is O(1); lookups and edits are O(log n).
+class PersistentConfig : public ConfigSource
+{
+public:
+   PersistentConfig();
+
+   //Takes the keys of config, including inherited ones of dotted sections
+   explicit PersistentConfig(const ConfigParser& config);
+
+   ~PersistentConfig();
+
+   //New version with section:key set to value. The value's type and
+   //line are kept as given.
+   PersistentConfig Set(const std::string& section, const std::string& key, const Token& value) const;
+
+   //New version without section:key. Returns an equal version if the
+   //key is not present.
+   PersistentConfig Erase(const std::string& section, const std::string& key) const;
+
+   //Number of keys
+   size_t Size() const;
+
+   bool Contains(const std::string& section, const std::string& key) const;
+
+   virtual bool Find(const std::string& section, const std::string& key, Token& value) const;
+
+private:
+   typedef struct entry
+   {
+      unsigned long long hash;
+      std::string section;
+      std::string key;
+      Token value;
+   } Entry;
+
+   struct node;
+   typedef std::shared_ptr<const Entry> EntryPtr;
+   typedef std::shared_ptr<const struct node> NodePtr;
+
+   //Exactly one of entry and child is set
+   typedef struct slot
+   {
+      EntryPtr entry;
+      NodePtr child;
+   } Slot;
+
+   typedef struct node
+   {
+      unsigned int bitmap;            //Bit i set if a slot has hash fragment i
+      std::vector<Slot> slots;        //One per set bit, in bit order
+      std::vector<EntryPtr> collided; //Only below the last hash level
+   } Node;
+
+   PersistentConfig(const NodePtr& root, size_t size);
+
+   static unsigned long long Hash(const std::string& section, const std::string& key);
+   static bool Matches(const Entry& entry, unsigned long long hash, const std::string& section, const std::string& key);
+
+   static NodePtr Insert(const NodePtr& node, unsigned int level, const EntryPtr& entry, bool& added);
+   static NodePtr Remove(const NodePtr& node, unsigned int level, unsigned long long hash,
+      const std::string& section, const std::string& key, bool& removed);
+   static NodePtr Pair(const EntryPtr& a, const EntryPtr& b, unsigned int level);
+   static EntryPtr OnlyEntry(const NodePtr& node);
+
+   NodePtr mRoot; //NULL when empty
+   size_t mSize;
+};
+
+}
+
+#endif /* PERSISTENT_CONFIG_H */
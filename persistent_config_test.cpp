@@ -0,0 +1,144 @@
+#include "persistent_config.h"
+#include "parse_utilities.h"
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+SimpleConfig::ConfigParser ParseText(const std::string& text)
+{
+   std::istringstream configStream(text);
+   SimpleConfig::ConfigParser c;
+   c.Parse(configStream);
+   return c;
+}
+
+SimpleConfig::Token MakeToken(SimpleConfig::TokenType type, const std::string& lexeme)
+{
+   SimpleConfig::Token tok;
+   tok.type = type;
+   tok.lexeme = lexeme;
+   tok.lineNum = 0;
+   return tok;
+}
+
+TEST(PersistentConfigTest, StartsEmpty)
+{
+   SimpleConfig::PersistentConfig config;
+   EXPECT_EQ(0u, config.Size());
+   EXPECT_FALSE(config.Contains("", "port"));
+   EXPECT_THROW(config.LookupInteger("port"), std::invalid_argument);
+   EXPECT_EQ(0u, config.Erase("", "port").Size());
+}
+
+TEST(PersistentConfigTest, TakesKeysOfParser)
+{
+   SimpleConfig::PersistentConfig config(ParseText("port=80\n[server]\nhost=\"a\"\n[server.eu]\nport=81\n"));
+   EXPECT_EQ(4u, config.Size());
+   EXPECT_EQ(80, config.LookupInteger("port"));
+   EXPECT_EQ("a", config.LookupString("server", "host"));
+   EXPECT_EQ("a", config.LookupString("server.eu", "host"));
+   EXPECT_EQ(81, config.LookupInteger("server.eu", "port"));
+   EXPECT_EQ(5, config.Lookup("server.eu", "port").lineNum);
+}
+
+TEST(PersistentConfigTest, SetLeavesOldVersionUntouched)
+{
+   SimpleConfig::PersistentConfig base(ParseText("port=80\n[log]\nlevel=1\n"));
+   SimpleConfig::PersistentConfig changed = base.Set("", "port", MakeToken(SimpleConfig::INTEGER, "8080"));
+   SimpleConfig::PersistentConfig added = changed.Set("log", "file", MakeToken(SimpleConfig::STRING, "/var/log/a"));
+
+   EXPECT_EQ(80, base.LookupInteger("port"));
+   EXPECT_EQ(8080, changed.LookupInteger("port"));
+   EXPECT_EQ(8080, added.LookupInteger("port"));
+   EXPECT_EQ(2u, base.Size());
+   EXPECT_EQ(2u, changed.Size());
+   EXPECT_EQ(3u, added.Size());
+   EXPECT_FALSE(changed.Contains("log", "file"));
+   EXPECT_EQ("/var/log/a", added.LookupString("log", "file"));
+}
+
+TEST(PersistentConfigTest, EraseLeavesOldVersionUntouched)
+{
+   SimpleConfig::PersistentConfig base(ParseText("port=80\n[log]\nlevel=1\n"));
+   SimpleConfig::PersistentConfig erased = base.Erase("log", "level");
+
+   EXPECT_EQ(1u, erased.Size());
+   EXPECT_THROW(erased.LookupInteger("log", "level"), std::invalid_argument);
+   EXPECT_EQ(1, base.LookupInteger("log", "level"));
+   EXPECT_EQ(2u, base.Size());
+   EXPECT_EQ(1u, erased.Erase("log", "missing").Size());
+   EXPECT_EQ(0u, erased.Erase("", "port").Size());
+}
+
+TEST(PersistentConfigTest, SetKeepsValueType)
+{
+   SimpleConfig::PersistentConfig config = SimpleConfig::PersistentConfig().Set("", "ratio", MakeToken(SimpleConfig::REAL_NUMBER, "0.5"));
+   EXPECT_DOUBLE_EQ(0.5, config.LookupDouble("ratio"));
+   EXPECT_THROW(config.LookupInteger("ratio"), std::logic_error);
+}
+
+//Every snapshot taken along a long run of random edits must still
+//match the keys it had when it was taken
+TEST(PersistentConfigTest, SnapshotsMatchReferenceAfterManyEdits)
+{
+   typedef std::map<std::pair<std::string, std::string>, std::string> Reference;
+   std::vector<SimpleConfig::PersistentConfig> snapshots;
+   std::vector<Reference> references;
+
+   std::srand(42);
+   SimpleConfig::PersistentConfig config;
+   Reference reference;
+   for(int i = 0; i < 20000; i++)
+   {
+      std::string section = "section" + SimpleConfig::LongLong2Str(std::rand() % 20);
+      std::string key = "key" + SimpleConfig::LongLong2Str(std::rand() % 300);
+      if(std::rand() % 3 == 0)
+      {
+         config = config.Erase(section, key);
+         reference.erase(std::make_pair(section, key));
+      }
+      else
+      {
+         std::string value = SimpleConfig::LongLong2Str(i);
+         config = config.Set(section, key, MakeToken(SimpleConfig::INTEGER, value));
+         reference[std::make_pair(section, key)] = value;
+      }
+      ASSERT_EQ(reference.size(), config.Size());
+
+      if(i % 2000 == 0)
+      {
+         snapshots.push_back(config);
+         references.push_back(reference);
+      }
+   }
+   snapshots.push_back(config);
+   references.push_back(reference);
+
+   for(size_t s = 0; s < snapshots.size(); s++)
+   {
+      EXPECT_EQ(references[s].size(), snapshots[s].Size());
+      for(int section = 0; section < 20; section++)
+      {
+         for(int key = 0; key < 300; key++)
+         {
+            std::pair<std::string, std::string> name("section" + SimpleConfig::LongLong2Str(section), "key" + SimpleConfig::LongLong2Str(key));
+            Reference::const_iterator it = references[s].find(name);
+            SimpleConfig::Token value;
+            bool found = snapshots[s].Find(name.first, name.second, value);
+            ASSERT_EQ(it != references[s].end(), found);
+            if(found)
+            {
+               EXPECT_EQ(it->second, value.lexeme);
+            }
+         }
+      }
+   }
+}
+
+}
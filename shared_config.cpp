@@ -0,0 +1,348 @@
+#include "shared_config.h"
+#include "parse_utilities.h"
+#include <climits>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SimpleConfig
+{
+
+typedef ConfigParser::KeyIndex KeyMap;
+
+static const unsigned int IMAGE_MAGIC = 0x53434647; //"SCFG"
+static const unsigned int IMAGE_VERSION = 1;
+
+static void SharedMemoryError(const std::string& what, const std::string& name)
+{
+   throw std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+static std::string ImageName(const std::string& name, unsigned long long generation)
+{
+   return name + "." + LongLong2Str(static_cast<long long>(generation));
+}
+
+static unsigned int CheckedOffset(size_t offset)
+{
+   if(offset > UINT_MAX)
+   {
+      throw std::runtime_error("Config too large to publish");
+   }
+   return static_cast<unsigned int>(offset);
+}
+
+static int CompareBytes(const char* a, size_t aLength, const std::string& b)
+{
+   int result = std::memcmp(a, b.data(), aLength < b.size() ? aLength : b.size());
+   if(result != 0)
+   {
+      return result;
+   }
+   return aLength < b.size() ? -1 : (aLength > b.size() ? 1 : 0);
+}
+
+
+SharedConfig::SharedConfig(const std::string& name):
+   mName(name), mCounter(NULL), mImage(NULL), mImageSize(0)
+{
+   int fd = shm_open(name.c_str(), O_RDONLY, 0);
+   if(fd < 0)
+   {
+      SharedMemoryError("Could not open shared config", name);
+   }
+   void* counter = mmap(NULL, sizeof(unsigned long long), PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if(counter == MAP_FAILED)
+   {
+      SharedMemoryError("Could not map shared config", name);
+   }
+   mCounter = static_cast<const unsigned long long*>(counter);
+
+   try
+   {
+      Attach();
+   }
+   catch(...)
+   {
+      munmap(const_cast<unsigned long long*>(mCounter), sizeof(unsigned long long));
+      throw;
+   }
+}
+
+SharedConfig::~SharedConfig()
+{
+   Detach();
+   munmap(const_cast<unsigned long long*>(mCounter), sizeof(unsigned long long));
+}
+
+unsigned long long SharedConfig::Publish(const std::string& name, const ConfigParser& config)
+{
+   //Dotted sections are published with their inherited keys, so
+   //readers need no fallback logic
+   std::map<std::string, const KeyMap*> sections;
+   config.VisibleSections(sections);
+
+   //Entries come out of the maps already sorted by section, then key
+   std::vector<ImageEntry> entries;
+   std::string text;
+   for(std::map<std::string, const KeyMap*>::const_iterator sectionIt = sections.begin(); sectionIt != sections.end(); ++sectionIt)
+   {
+      unsigned int sectionOffset = CheckedOffset(text.size());
+      text += sectionIt->first;
+      for(KeyMap::const_iterator keyIt = sectionIt->second->begin(); keyIt != sectionIt->second->end(); ++keyIt)
+      {
+         ImageEntry entry;
+         entry.sectionOffset = sectionOffset;
+         entry.sectionLength = CheckedOffset(sectionIt->first.size());
+         entry.keyOffset = CheckedOffset(text.size());
+         entry.keyLength = CheckedOffset(keyIt->first.size());
+         text += keyIt->first;
+         entry.line = config.mValues.Line(keyIt->second);
+         entry.reserved = 0;
+
+         const Value& cell = config.mValues.Cell(keyIt->second);
+         Value::Storage storage = cell.GetStorage();
+         if(storage == Value::NUMBER_BITS || storage == Value::REAL_BITS || storage == Value::INLINE_TEXT)
+         {
+            entry.value = cell;
+         }
+         else
+         {
+            std::string value = config.mValues.Text(keyIt->second);
+            if(value.size() <= Value::MAX_INLINE)
+            {
+               entry.value = Value::FromInlineText(cell.Type(), value.data(), value.size());
+            }
+            else
+            {
+               entry.value = Value::FromPooledText(cell.Type(), CheckedOffset(text.size()), value.size());
+               text += value;
+            }
+         }
+         entries.push_back(entry);
+      }
+   }
+
+   //The counter object is created on the first publish
+   int counterFd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+   if(counterFd < 0)
+   {
+      SharedMemoryError("Could not create shared config", name);
+   }
+   struct stat counterStat;
+   if(fstat(counterFd, &counterStat) != 0 ||
+      (counterStat.st_size < static_cast<off_t>(sizeof(unsigned long long)) &&
+       ftruncate(counterFd, sizeof(unsigned long long)) != 0))
+   {
+      close(counterFd);
+      SharedMemoryError("Could not size shared config", name);
+   }
+   void* counterMap = mmap(NULL, sizeof(unsigned long long), PROT_READ | PROT_WRITE, MAP_SHARED, counterFd, 0);
+   close(counterFd);
+   if(counterMap == MAP_FAILED)
+   {
+      SharedMemoryError("Could not map shared config", name);
+   }
+   unsigned long long* counter = static_cast<unsigned long long*>(counterMap);
+   unsigned long long previous = __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+   unsigned long long generation = previous + 1;
+
+   ImageHeader header;
+   header.magic = IMAGE_MAGIC;
+   header.version = IMAGE_VERSION;
+   header.generation = generation;
+   header.entryCount = entries.size();
+   header.textOffset = sizeof(ImageHeader) + entries.size() * sizeof(ImageEntry);
+   header.size = header.textOffset + text.size();
+
+   //A publisher that died half way may have left this name behind
+   std::string imageName = ImageName(name, generation);
+   shm_unlink(imageName.c_str());
+   int imageFd = shm_open(imageName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+   if(imageFd < 0 || ftruncate(imageFd, header.size) != 0)
+   {
+      int error = errno;
+      if(imageFd >= 0)
+      {
+         close(imageFd);
+      }
+      munmap(counter, sizeof(unsigned long long));
+      errno = error;
+      SharedMemoryError("Could not create shared config", imageName);
+   }
+   void* imageMap = mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, imageFd, 0);
+   close(imageFd);
+   if(imageMap == MAP_FAILED)
+   {
+      int error = errno;
+      munmap(counter, sizeof(unsigned long long));
+      shm_unlink(imageName.c_str());
+      errno = error;
+      SharedMemoryError("Could not map shared config", imageName);
+   }
+
+   char* image = static_cast<char*>(imageMap);
+   std::memcpy(image, &header, sizeof(header));
+   if(!entries.empty())
+   {
+      std::memcpy(image + sizeof(header), &entries[0], entries.size() * sizeof(ImageEntry));
+   }
+   std::memcpy(image + header.textOffset, text.data(), text.size());
+   munmap(imageMap, header.size);
+
+   //Readers that see the new generation find a complete image
+   __atomic_store_n(counter, generation, __ATOMIC_RELEASE);
+   munmap(counter, sizeof(unsigned long long));
+
+   if(previous != 0)
+   {
+      shm_unlink(ImageName(name, previous).c_str());
+   }
+   return generation;
+}
+
+void SharedConfig::Unpublish(const std::string& name)
+{
+   int fd = shm_open(name.c_str(), O_RDONLY, 0);
+   if(fd < 0)
+   {
+      return;
+   }
+   unsigned long long generation = 0;
+   void* counter = mmap(NULL, sizeof(unsigned long long), PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if(counter != MAP_FAILED)
+   {
+      generation = __atomic_load_n(static_cast<unsigned long long*>(counter), __ATOMIC_ACQUIRE);
+      munmap(counter, sizeof(unsigned long long));
+   }
+   if(generation != 0)
+   {
+      shm_unlink(ImageName(name, generation).c_str());
+   }
+   shm_unlink(name.c_str());
+}
+
+unsigned long long SharedConfig::Generation() const
+{
+   return reinterpret_cast<const ImageHeader*>(mImage)->generation;
+}
+
+bool SharedConfig::IsCurrent() const
+{
+   return __atomic_load_n(mCounter, __ATOMIC_ACQUIRE) == Generation();
+}
+
+void SharedConfig::Reattach()
+{
+   Detach();
+   Attach();
+}
+
+//A republish can unlink the image between reading the counter and
+//opening it; the counter has moved on by then, so try again
+void SharedConfig::Attach()
+{
+   while(true)
+   {
+      unsigned long long generation = __atomic_load_n(mCounter, __ATOMIC_ACQUIRE);
+      if(generation == 0)
+      {
+         throw std::runtime_error("Nothing published as shared config " + mName);
+      }
+
+      std::string imageName = ImageName(mName, generation);
+      int fd = shm_open(imageName.c_str(), O_RDONLY, 0);
+      if(fd < 0)
+      {
+         if(errno == ENOENT && __atomic_load_n(mCounter, __ATOMIC_ACQUIRE) != generation)
+         {
+            continue;
+         }
+         SharedMemoryError("Could not open shared config", imageName);
+      }
+
+      struct stat imageStat;
+      if(fstat(fd, &imageStat) != 0 || imageStat.st_size < static_cast<off_t>(sizeof(ImageHeader)))
+      {
+         close(fd);
+         throw std::runtime_error("Shared config " + imageName + " is not a config image");
+      }
+      void* image = mmap(NULL, imageStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if(image == MAP_FAILED)
+      {
+         SharedMemoryError("Could not map shared config", imageName);
+      }
+      mImage = static_cast<const char*>(image);
+      mImageSize = imageStat.st_size;
+
+      const ImageHeader* header = reinterpret_cast<const ImageHeader*>(mImage);
+      if(header->magic != IMAGE_MAGIC || header->version != IMAGE_VERSION || header->size != mImageSize ||
+         header->textOffset != sizeof(ImageHeader) + header->entryCount * sizeof(ImageEntry))
+      {
+         Detach();
+         throw std::runtime_error("Shared config " + imageName + " is not a config image");
+      }
+      return;
+   }
+}
+
+void SharedConfig::Detach()
+{
+   if(mImage)
+   {
+      munmap(const_cast<char*>(mImage), mImageSize);
+      mImage = NULL;
+      mImageSize = 0;
+   }
+}
+
+int SharedConfig::Compare(const ImageEntry& entry, const std::string& section, const std::string& key) const
+{
+   const char* text = mImage + reinterpret_cast<const ImageHeader*>(mImage)->textOffset;
+   int result = CompareBytes(text + entry.sectionOffset, entry.sectionLength, section);
+   if(result != 0)
+   {
+      return result;
+   }
+   return CompareBytes(text + entry.keyOffset, entry.keyLength, key);
+}
+
+bool SharedConfig::Find(const std::string& section, const std::string& key, Token& value) const
+{
+   const ImageHeader* header = reinterpret_cast<const ImageHeader*>(mImage);
+   const ImageEntry* entries = reinterpret_cast<const ImageEntry*>(mImage + sizeof(ImageHeader));
+
+   size_t low = 0;
+   size_t high = header->entryCount;
+   while(low < high)
+   {
+      size_t mid = low + (high - low) / 2;
+      int result = Compare(entries[mid], section, key);
+      if(result == 0)
+      {
+         value.type = entries[mid].value.Type();
+         value.lexeme = entries[mid].value.Text(mImage + header->textOffset);
+         value.lineNum = entries[mid].line;
+         return true;
+      }
+      if(result < 0)
+      {
+         low = mid + 1;
+      }
+      else
+      {
+         high = mid;
+      }
+   }
+   return false;
+}
+
+}
@@ -0,0 +1,87 @@
+#ifndef SHARED_CONFIG_H
+#define SHARED_CONFIG_H
+
+#include <string>
+#include "config_source.h"
+#include "config_parser.h"
+#include "value_store.h"
+
+namespace SimpleConfig
+{
+
+//Read-only view of a config published in POSIX shared memory, so that
+//many processes can share one parse. The image holds the entries sorted
+//by section and key, and refers to strings by offset, so every process
+//can map it at a different address.
+//
+//name is a shared memory object name such as "/myapp.config". Each
+//publish writes a new image object (name + ".<generation>") and then
+//advances the generation counter in the object called name. Attached
+//readers keep their image until they Reattach, even after a republish.
+class SharedConfig : public ConfigSource
+{
+public:
+   //Attaches to the current image. Throws std::runtime_error if nothing
+   //has been published under name.
+   explicit SharedConfig(const std::string& name);
+   ~SharedConfig();
+
+   //Publishes config under name, replacing (and unlinking) the previous
+   //image. Returns the new generation. Publishers must not run
+   //concurrently for the same name.
+   static unsigned long long Publish(const std::string& name, const ConfigParser& config);
+
+   //Unlinks the image and the generation counter
+   static void Unpublish(const std::string& name);
+
+   //Generation of the attached image
+   unsigned long long Generation() const;
+
+   //False once a newer generation has been published
+   bool IsCurrent() const;
+
+   //Drops the attached image and attaches to the current one
+   void Reattach();
+
+   virtual bool Find(const std::string& section, const std::string& key, Token& value) const;
+
+private:
+   SharedConfig(const SharedConfig&);
+   SharedConfig& operator=(const SharedConfig&);
+
+   typedef struct imageHeader
+   {
+      unsigned int magic;
+      unsigned int version;
+      unsigned long long generation;
+      unsigned long long entryCount;
+      unsigned long long textOffset; //Start of the string bytes
+      unsigned long long size;       //Size of the whole image
+   } ImageHeader;
+
+   //Names are offsets into the string bytes. The value cell is stored as
+   //in ValueStore, with long text pooled in the image's string bytes.
+   typedef struct imageEntry
+   {
+      unsigned int sectionOffset;
+      unsigned int sectionLength;
+      unsigned int keyOffset;
+      unsigned int keyLength;
+      int line;
+      unsigned int reserved;
+      Value value;
+   } ImageEntry;
+
+   void Attach();
+   void Detach();
+   int Compare(const ImageEntry& entry, const std::string& section, const std::string& key) const;
+
+   std::string mName;
+   const unsigned long long* mCounter; //Mapped generation counter
+   const char* mImage;
+   size_t mImageSize;
+};
+
+}
+
+#endif /* SHARED_CONFIG_H */
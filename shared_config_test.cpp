@@ -0,0 +1,118 @@
+#include "shared_config.h"
+#include "config_parser.h"
+#include "parse_utilities.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+class SharedConfigTest : public ::testing::Test
+{
+protected:
+
+   SharedConfigTest():
+      name("/simpleconfig_test." + SimpleConfig::LongLong2Str(getpid()))
+   {
+      SimpleConfig::SharedConfig::Unpublish(name);
+   }
+
+   ~SharedConfigTest()
+   {
+      SimpleConfig::SharedConfig::Unpublish(name);
+   }
+
+   unsigned long long Publish(const std::string& text)
+   {
+      std::istringstream configStream(text);
+      SimpleConfig::ConfigParser c;
+      c.Parse(configStream);
+      return SimpleConfig::SharedConfig::Publish(name, c);
+   }
+
+   std::string name;
+};
+
+TEST_F(SharedConfigTest, NothingPublishedThrows)
+{
+   EXPECT_THROW(SimpleConfig::SharedConfig config(name), std::runtime_error);
+}
+
+TEST_F(SharedConfigTest, LookupsReadTheImage)
+{
+   Publish("port=8080\nratio=0.5\nname=\"a name longer than one cell\"\n"
+           "[Log]\nverbose=true\nlevels=[1, 2]\n");
+   SimpleConfig::SharedConfig config(name);
+
+   EXPECT_EQ(8080, config.LookupInteger("port"));
+   EXPECT_EQ(0.5, config.LookupDouble("ratio"));
+   EXPECT_EQ("a name longer than one cell", config.LookupString("name"));
+   EXPECT_TRUE(config.LookupBoolean("Log", "verbose"));
+   EXPECT_EQ("[1, 2]", config.LookupString("Log", "levels"));
+   EXPECT_EQ(6, config.Lookup("Log", "levels").lineNum);
+   EXPECT_THROW(config.LookupInteger("Log", "port"), std::invalid_argument);
+   EXPECT_THROW(config.LookupInteger("Missing", "port"), std::invalid_argument);
+}
+
+TEST_F(SharedConfigTest, DottedSectionsArePublishedWithInheritedKeys)
+{
+   Publish("[prod]\nport=80\n[prod.web]\nthreads=8\n");
+   SimpleConfig::SharedConfig config(name);
+   EXPECT_EQ(80, config.LookupInteger("prod.web", "port"));
+   EXPECT_EQ(8, config.LookupInteger("prod.web", "threads"));
+}
+
+TEST_F(SharedConfigTest, EmptyConfigPublishes)
+{
+   Publish("");
+   SimpleConfig::SharedConfig config(name);
+   EXPECT_THROW(config.LookupInteger("port"), std::invalid_argument);
+}
+
+TEST_F(SharedConfigTest, RepublishIsNoticed)
+{
+   EXPECT_EQ(1u, Publish("port=1\n"));
+   SimpleConfig::SharedConfig config(name);
+   EXPECT_EQ(1u, config.Generation());
+   EXPECT_TRUE(config.IsCurrent());
+
+   EXPECT_EQ(2u, Publish("port=2\n"));
+   EXPECT_FALSE(config.IsCurrent());
+   EXPECT_EQ(1, config.LookupInteger("port"));
+
+   config.Reattach();
+   EXPECT_TRUE(config.IsCurrent());
+   EXPECT_EQ(2u, config.Generation());
+   EXPECT_EQ(2, config.LookupInteger("port"));
+}
+
+TEST_F(SharedConfigTest, OtherProcessesAttach)
+{
+   Publish("[Worker]\ncount=64\n");
+
+   pid_t child = fork();
+   ASSERT_NE(-1, child);
+   if(child == 0)
+   {
+      int status = 1;
+      try
+      {
+         SimpleConfig::SharedConfig config(name);
+         status = config.LookupInteger("Worker", "count") == 64 ? 0 : 1;
+      }
+      catch(...)
+      {
+      }
+      _exit(status);
+   }
+
+   int status = 0;
+   ASSERT_EQ(child, waitpid(child, &status, 0));
+   EXPECT_TRUE(WIFEXITED(status));
+   EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+namespace SimpleConfig
+{
+
+//Bounded lock-free queue for exactly one producer thread and one
+//consumer thread. Capacity is rounded up to a power of two. Each index
+//is written by only one side; they live on separate cache lines so the
+//two threads do not contend for the same line.
+template<typename T>
+class SpscRing
+{
+public:
+   explicit SpscRing(size_t capacity): mHead(0), mTail(0)
+   {
+      size_t size = 2;
+      while(size < capacity)
+      {
+         size *= 2;
+      }
+      mSlots.resize(size);
+      mMask = size - 1;
+   }
+
+   //Producer side. Swaps item into the ring; returns false if full.
+   bool TryPush(T& item)
+   {
+      size_t tail = mTail.load(std::memory_order_relaxed);
+      if(tail - mHead.load(std::memory_order_acquire) == mSlots.size())
+      {
+         return false;
+      }
+      std::swap(mSlots[tail & mMask], item);
+      mTail.store(tail + 1, std::memory_order_release);
+      return true;
+   }
+
+   //Consumer side. Swaps the oldest item out; returns false if empty.
+   bool TryPop(T& item)
+   {
+      size_t head = mHead.load(std::memory_order_relaxed);
+      if(head == mTail.load(std::memory_order_acquire))
+      {
+         return false;
+      }
+      std::swap(item, mSlots[head & mMask]);
+      mHead.store(head + 1, std::memory_order_release);
+      return true;
+   }
+
+private:
+   SpscRing(const SpscRing&);
+   SpscRing& operator=(const SpscRing&);
+
+   std::vector<T> mSlots;
+   size_t mMask;
+   alignas(64) std::atomic<size_t> mHead; //Next slot to pop, written by the consumer
+   alignas(64) std::atomic<size_t> mTail; //Next slot to push, written by the producer
+};
+
+}
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,69 @@
+#include "spsc_ring.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+namespace
+{
+
+TEST(SpscRingTest, PushAndPopInOrder)
+{
+   SimpleConfig::SpscRing<int> ring(3);
+   int value = 1;
+   EXPECT_TRUE(ring.TryPush(value));
+   value = 2;
+   EXPECT_TRUE(ring.TryPush(value));
+
+   int popped = 0;
+   EXPECT_TRUE(ring.TryPop(popped));
+   EXPECT_EQ(1, popped);
+   EXPECT_TRUE(ring.TryPop(popped));
+   EXPECT_EQ(2, popped);
+   EXPECT_FALSE(ring.TryPop(popped));
+}
+
+TEST(SpscRingTest, FullRingRefusesPush)
+{
+   SimpleConfig::SpscRing<int> ring(4);
+   for(int i = 0; i < 4; i++)
+   {
+      int value = i;
+      EXPECT_TRUE(ring.TryPush(value));
+   }
+   int value = 4;
+   EXPECT_FALSE(ring.TryPush(value));
+
+   int popped = 0;
+   EXPECT_TRUE(ring.TryPop(popped));
+   EXPECT_TRUE(ring.TryPush(value));
+}
+
+TEST(SpscRingTest, TwoThreadsSeeEveryItemOnce)
+{
+   const int count = 100000;
+   SimpleConfig::SpscRing<int> ring(64);
+   std::thread producer([&ring, count]()
+   {
+      for(int i = 0; i < count; i++)
+      {
+         int value = i;
+         while(!ring.TryPush(value))
+         {
+            std::this_thread::yield();
+         }
+      }
+   });
+
+   int expected = 0;
+   while(expected < count)
+   {
+      int value = -1;
+      if(ring.TryPop(value))
+      {
+         ASSERT_EQ(expected, value);
+         expected++;
+      }
+   }
+   producer.join();
+}
+
+}
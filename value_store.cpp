@@ -0,0 +1,453 @@
+#include "value_store.h"
+#include "parse_utilities.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace SimpleConfig
+{
+
+Value::Value()
+{
+   std::memset(this, 0, sizeof(Value));
+}
+
+Value Value::Make(TokenType type, Storage storage)
+{
+   Value v;
+   v.mTag = static_cast<unsigned char>(type | (storage << 4));
+   return v;
+}
+
+Value Value::FromInteger(TokenType type, long long i)
+{
+   Value v = Make(type, NUMBER_BITS);
+   std::memcpy(v.mBytes, &i, sizeof(i));
+   return v;
+}
+
+Value Value::FromReal(double d)
+{
+   Value v = Make(REAL_NUMBER, REAL_BITS);
+   std::memcpy(v.mBytes, &d, sizeof(d));
+   return v;
+}
+
+Value Value::FromInlineText(TokenType type, const char* text, size_t length)
+{
+   Value v = Make(type, INLINE_TEXT);
+   std::memcpy(v.mBytes, text, length);
+   v.mLength = static_cast<unsigned char>(length);
+   return v;
+}
+
+Value Value::FromPooledText(TokenType type, size_t offset, size_t length)
+{
+   Value v = Make(type, POOLED_TEXT);
+   unsigned long long off = offset;
+   unsigned int len = static_cast<unsigned int>(length);
+   std::memcpy(v.mBytes, &off, sizeof(off));
+   std::memcpy(v.mBytes + sizeof(off), &len, sizeof(len));
+   return v;
+}
+
+Value Value::FromExternalText(TokenType type, const char* text, size_t length)
+{
+   Value v = Make(type, EXTERNAL_TEXT);
+   unsigned int len = static_cast<unsigned int>(length);
+   std::memcpy(v.mBytes, &text, sizeof(text));
+   std::memcpy(v.mBytes + sizeof(text), &len, sizeof(len));
+   return v;
+}
+
+Value Value::FromList(size_t index)
+{
+   Value v = Make(LIST, LIST_INDEX);
+   unsigned long long i = index;
+   std::memcpy(v.mBytes, &i, sizeof(i));
+   return v;
+}
+
+TokenType Value::Type() const
+{
+   return static_cast<TokenType>(mTag & 0x0F);
+}
+
+Value::Storage Value::GetStorage() const
+{
+   return static_cast<Storage>(mTag >> 4);
+}
+
+long long Value::Integer() const
+{
+   long long i;
+   std::memcpy(&i, mBytes, sizeof(i));
+   return i;
+}
+
+double Value::Real() const
+{
+   double d;
+   std::memcpy(&d, mBytes, sizeof(d));
+   return d;
+}
+
+const char* Value::InlineText() const
+{
+   return mBytes;
+}
+
+const char* Value::ExternalText() const
+{
+   const char* text;
+   std::memcpy(&text, mBytes, sizeof(text));
+   return text;
+}
+
+size_t Value::Offset() const
+{
+   unsigned long long off;
+   std::memcpy(&off, mBytes, sizeof(off));
+   return off;
+}
+
+size_t Value::TextLength() const
+{
+   if(GetStorage() == INLINE_TEXT)
+   {
+      return mLength;
+   }
+   unsigned int len;
+   std::memcpy(&len, mBytes + 8, sizeof(len));
+   return len;
+}
+
+size_t Value::ListIndex() const
+{
+   return Offset();
+}
+
+std::string Value::Text(const char* pool) const
+{
+   switch(GetStorage())
+   {
+   case NUMBER_BITS:
+      if(Type() == BOOL)
+      {
+         return Integer() ? "true" : "false";
+      }
+      return LongLong2Str(Integer());
+   case REAL_BITS:
+      return Double2Str(Real());
+   case INLINE_TEXT:
+      return std::string(InlineText(), TextLength());
+   case POOLED_TEXT:
+      return std::string(pool + Offset(), TextLength());
+   case EXTERNAL_TEXT:
+      return std::string(ExternalText(), TextLength());
+   default:
+      return std::string();
+   }
+}
+
+
+ValueStore::ValueStore(): mListCount(0)
+{}
+
+ValueStore::~ValueStore()
+{}
+
+size_t ValueStore::Size() const
+{
+   return mCells.size();
+}
+
+void ValueStore::Clear()
+{
+   mCells.clear();
+   mLines.clear();
+   mText.clear();
+   mListCount = 0;
+   mFreeLists.clear();
+}
+
+size_t ValueStore::MemoryUsage() const
+{
+   size_t bytes = mCells.capacity() * sizeof(Value) + mLines.capacity() * sizeof(int) +
+      mText.capacity() + mLists.capacity() * sizeof(ListValue) + mFreeLists.capacity() * sizeof(size_t);
+   for(size_t i = 0; i < mLists.size(); i++)
+   {
+      const ListValue& list = mLists[i];
+      bytes += list.text.capacity() + list.elements.capacity() * sizeof(Token) +
+         list.integers.capacity() * sizeof(long long) + list.reals.capacity() * sizeof(double);
+      for(size_t j = 0; j < list.elements.size(); j++)
+      {
+         bytes += list.elements[j].lexeme.capacity();
+      }
+   }
+   return bytes;
+}
+
+size_t ValueStore::Add(const Token& tok, const char* external /* =NULL */)
+{
+   mCells.push_back(Encode(tok, external, NULL));
+   mLines.push_back(tok.lineNum);
+   return mCells.size() - 1;
+}
+
+//A list slot the cell held is released for the next list
+void ValueStore::Set(size_t index, const Token& tok, const char* external /* =NULL */)
+{
+   Value old = mCells[index];
+   if(old.GetStorage() == Value::LIST_INDEX)
+   {
+      mFreeLists.push_back(old.ListIndex());
+   }
+   mCells[index] = Encode(tok, external, &old);
+   mLines[index] = tok.lineNum;
+}
+
+size_t ValueStore::AddList(ListValue& list, int line)
+{
+   size_t slot = NewListSlot();
+   FillListSlot(slot, list);
+   mCells.push_back(Value::FromList(slot));
+   mLines.push_back(line);
+   return mCells.size() - 1;
+}
+
+//Reuses the cell's own slot if it already holds a list
+void ValueStore::SetList(size_t index, ListValue& list, int line)
+{
+   const Value& old = mCells[index];
+   size_t slot = (old.GetStorage() == Value::LIST_INDEX) ? old.ListIndex() : NewListSlot();
+   FillListSlot(slot, list);
+   mCells[index] = Value::FromList(slot);
+   mLines[index] = line;
+}
+
+//A released slot, else one left over from before Clear, else a new one
+size_t ValueStore::NewListSlot()
+{
+   if(!mFreeLists.empty())
+   {
+      size_t slot = mFreeLists.back();
+      mFreeLists.pop_back();
+      return slot;
+   }
+   if(mListCount == mLists.size())
+   {
+      mLists.push_back(ListValue());
+   }
+   return mListCount++;
+}
+
+//Hands list the slot's old buffers in exchange
+void ValueStore::FillListSlot(size_t slot, ListValue& list)
+{
+   ListValue& target = mLists[slot];
+   target.text.swap(list.text);
+   target.elements.swap(list.elements);
+   target.integers.swap(list.integers);
+   target.reals.swap(list.reals);
+}
+
+//Numbers and booleans are stored converted only when they print back
+//as their source text, so that text lookups, diffs and emitted output
+//keep the lexeme (0x10, 2.0, TRUE). Others, including numbers that do
+//not convert (e.g. out of range), keep their text and are converted by
+//lookups as before. Long text reuses the pooled bytes of old, if given,
+//when it fits in them or they end the pool.
+Value ValueStore::Encode(const Token& tok, const char* external, const Value* old)
+{
+   try
+   {
+      switch(tok.type)
+      {
+      case INTEGER:
+      {
+         long long i = Str2LongLong(tok.lexeme);
+         if(LongLong2Str(i) == tok.lexeme)
+         {
+            return Value::FromInteger(INTEGER, i);
+         }
+         break;
+      }
+      case BOOL:
+      {
+         bool b = Str2Bool(tok.lexeme);
+         if(tok.lexeme == (b ? "true" : "false"))
+         {
+            return Value::FromInteger(BOOL, b);
+         }
+         break;
+      }
+      case REAL_NUMBER:
+      {
+         double d = Str2Double(tok.lexeme);
+         if(Double2Str(d) == tok.lexeme)
+         {
+            return Value::FromReal(d);
+         }
+         break;
+      }
+      default:
+         break;
+      }
+   }
+   catch(std::logic_error&)
+   {
+   }
+
+   const std::string& text = tok.lexeme;
+   if(text.size() <= Value::MAX_INLINE)
+   {
+      return Value::FromInlineText(tok.type, text.data(), text.size());
+   }
+   if(external)
+   {
+      return Value::FromExternalText(tok.type, external, text.size());
+   }
+   if(old && old->GetStorage() == Value::POOLED_TEXT)
+   {
+      //The last range in the pool can grow as well
+      size_t offset = old->Offset();
+      bool last = (offset + old->TextLength() == mText.size());
+      if(last || text.size() <= old->TextLength())
+      {
+         if(last)
+         {
+            mText.resize(offset + text.size());
+         }
+         std::memcpy(&mText[offset], text.data(), text.size());
+         return Value::FromPooledText(tok.type, offset, text.size());
+      }
+   }
+   size_t offset = mText.size();
+   mText.insert(mText.end(), text.begin(), text.end());
+   return Value::FromPooledText(tok.type, offset, text.size());
+}
+
+const Value& ValueStore::Cell(size_t index) const
+{
+   return mCells[index];
+}
+
+TokenType ValueStore::Type(size_t index) const
+{
+   return mCells[index].Type();
+}
+
+int ValueStore::Line(size_t index) const
+{
+   return mLines[index];
+}
+
+const char* ValueStore::TextData(const Value& cell) const
+{
+   switch(cell.GetStorage())
+   {
+   case Value::INLINE_TEXT:
+      return cell.InlineText();
+   case Value::POOLED_TEXT:
+      return &mText[cell.Offset()];
+   case Value::EXTERNAL_TEXT:
+      return cell.ExternalText();
+   default:
+      return NULL;
+   }
+}
+
+std::string ValueStore::Text(size_t index) const
+{
+   const Value& cell = mCells[index];
+   if(cell.GetStorage() == Value::LIST_INDEX)
+   {
+      return mLists[cell.ListIndex()].text;
+   }
+   return cell.Text(mText.empty() ? NULL : &mText[0]);
+}
+
+const char* ValueStore::TextData(size_t index, char* scratch, size_t& length) const
+{
+   const Value& cell = mCells[index];
+   switch(cell.GetStorage())
+   {
+   case Value::NUMBER_BITS:
+      if(cell.Type() == BOOL)
+      {
+         length = cell.Integer() ? 4 : 5;
+         return cell.Integer() ? "true" : "false";
+      }
+      length = LongLong2Str(cell.Integer(), scratch);
+      return scratch;
+   case Value::REAL_BITS:
+      length = Double2Str(cell.Real(), scratch);
+      return scratch;
+   case Value::LIST_INDEX:
+   {
+      const std::string& text = mLists[cell.ListIndex()].text;
+      length = text.size();
+      return text.data();
+   }
+   default:
+      length = cell.TextLength();
+      return TextData(cell);
+   }
+}
+
+Token ValueStore::Get(size_t index) const
+{
+   Token tok;
+   tok.type = mCells[index].Type();
+   tok.lexeme = Text(index);
+   tok.lineNum = mLines[index];
+   return tok;
+}
+
+const ListValue* ValueStore::List(size_t index) const
+{
+   const Value& cell = mCells[index];
+   if(cell.GetStorage() != Value::LIST_INDEX)
+   {
+      return NULL;
+   }
+   return &mLists[cell.ListIndex()];
+}
+
+bool ValueStore::Equals(size_t index, const ValueStore& other, size_t otherIndex) const
+{
+   const Value& a = mCells[index];
+   const Value& b = other.mCells[otherIndex];
+   if(a.Type() != b.Type())
+   {
+      return false;
+   }
+
+   switch(a.GetStorage())
+   {
+   case Value::NUMBER_BITS:
+      if(b.GetStorage() == Value::NUMBER_BITS)
+      {
+         return a.Integer() == b.Integer();
+      }
+      break;
+   case Value::REAL_BITS:
+      if(b.GetStorage() == Value::REAL_BITS)
+      {
+         return a.Real() == b.Real();
+      }
+      break;
+   case Value::LIST_INDEX:
+      return List(index)->text == other.List(otherIndex)->text;
+   default:
+      if(b.GetStorage() != Value::NUMBER_BITS && b.GetStorage() != Value::REAL_BITS)
+      {
+         return a.TextLength() == b.TextLength() &&
+            std::memcmp(TextData(a), other.TextData(b), a.TextLength()) == 0;
+      }
+      break;
+   }
+   return Text(index) == other.Text(otherIndex);
+}
+
+}
@@ -0,0 +1,122 @@
+#ifndef VALUE_STORE_H
+#define VALUE_STORE_H
+
+#include <string>
+#include <vector>
+#include "config_lexer.h"
+
+namespace SimpleConfig
+{
+
+//16 byte value cell. Numbers and booleans written in canonical form are
+//stored converted, other ones keep their text. Strings of up to
+//MAX_INLINE bytes are stored inline, longer ones as the location of
+//their bytes. Byte copies keep the cell free of alignment padding.
+class Value
+{
+public:
+   typedef enum storage
+   {
+      INLINE_TEXT, POOLED_TEXT, EXTERNAL_TEXT, NUMBER_BITS, REAL_BITS, LIST_INDEX
+   } Storage;
+
+   static const size_t MAX_INLINE = 14;
+
+   Value();
+
+   static Value FromInteger(TokenType type, long long i);
+   static Value FromReal(double d);
+   static Value FromInlineText(TokenType type, const char* text, size_t length);
+   static Value FromPooledText(TokenType type, size_t offset, size_t length);
+   static Value FromExternalText(TokenType type, const char* text, size_t length);
+   static Value FromList(size_t index);
+
+   TokenType Type() const;
+   Storage GetStorage() const;
+
+   long long Integer() const;
+   double Real() const;
+   const char* InlineText() const;
+   const char* ExternalText() const;
+   size_t Offset() const;
+   size_t TextLength() const;
+   size_t ListIndex() const;
+
+   //Source text of any cell but a list. pool holds pooled text.
+   std::string Text(const char* pool) const;
+
+private:
+   static Value Make(TokenType type, Storage storage);
+
+   char mBytes[14];
+   unsigned char mLength;
+   unsigned char mTag; //TokenType in the low nibble, Storage in the high one
+};
+
+
+typedef struct listValue
+{
+   std::string text;                //Canonical source form, e.g. [1, 2]
+   std::vector<Token> elements;
+   std::vector<long long> integers; //Only for lists of integers
+   std::vector<double> reals;       //For any list of numbers
+} ListValue;
+
+
+//Indexed storage for parsed values. Cells are kept together; source
+//lines live in a parallel array that is only read when building a full
+//Token (diagnostics, Lookup).
+class ValueStore
+{
+public:
+   ValueStore();
+   ~ValueStore();
+
+   size_t Size() const;
+
+   //Removes every value but keeps the storage for reuse
+   void Clear();
+
+   //Approximate heap bytes held by the store
+   size_t MemoryUsage() const;
+
+   //external, if given, holds tok.lexeme and outlives the store; long
+   //strings then point there instead of being copied. Set reuses the
+   //storage of the value it replaces where it can.
+   size_t Add(const Token& tok, const char* external = NULL);
+   void Set(size_t index, const Token& tok, const char* external = NULL);
+
+   //Takes over the contents of list, handing it the buffers of a slot
+   //left over from before Clear if there is one
+   size_t AddList(ListValue& list, int line);
+   void SetList(size_t index, ListValue& list, int line);
+
+   const Value& Cell(size_t index) const;
+   TokenType Type(size_t index) const;
+   int Line(size_t index) const;
+   std::string Text(size_t index) const;
+   //Text of any cell without copying it. Converted numbers are printed
+   //into scratch, which needs NUMBER_TEXT_SIZE bytes.
+   const char* TextData(size_t index, char* scratch, size_t& length) const;
+   Token Get(size_t index) const;
+   const ListValue* List(size_t index) const;
+
+   bool Equals(size_t index, const ValueStore& other, size_t otherIndex) const;
+
+private:
+   Value Encode(const Token& tok, const char* external, const Value* old);
+   size_t NewListSlot();
+   void FillListSlot(size_t slot, ListValue& list);
+   const char* TextData(const Value& cell) const;
+
+   std::vector<Value> mCells;
+   std::vector<int> mLines;
+   std::vector<char> mText; //Bytes of long strings
+   std::vector<ListValue> mLists; //Slots past mListCount are left over from before Clear
+   size_t mListCount;
+   std::vector<size_t> mFreeLists; //Slots below mListCount no cell holds
+};
+
+}
+
+#endif /* VALUE_STORE_H */
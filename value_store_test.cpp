@@ -0,0 +1,205 @@
+#include "value_store.h"
+#include "parse_utilities.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace
+{
+
+SimpleConfig::Token MakeToken(SimpleConfig::TokenType type, const std::string& lexeme, int line)
+{
+   SimpleConfig::Token tok;
+   tok.type = type;
+   tok.lexeme = lexeme;
+   tok.lineNum = line;
+   return tok;
+}
+
+TEST(ValueTest, CellIsSixteenBytes)
+{
+   EXPECT_EQ(16u, sizeof(SimpleConfig::Value));
+}
+
+TEST(ValueStoreTest, NumbersAreStoredConverted)
+{
+   SimpleConfig::ValueStore store;
+   size_t i = store.Add(MakeToken(SimpleConfig::INTEGER, "-16", 3));
+   size_t d = store.Add(MakeToken(SimpleConfig::REAL_NUMBER, "2.5", 4));
+   size_t b = store.Add(MakeToken(SimpleConfig::BOOL, "true", 5));
+
+   EXPECT_EQ(SimpleConfig::Value::NUMBER_BITS, store.Cell(i).GetStorage());
+   EXPECT_EQ(-16, store.Cell(i).Integer());
+   EXPECT_EQ("-16", store.Text(i));
+   EXPECT_EQ(SimpleConfig::Value::REAL_BITS, store.Cell(d).GetStorage());
+   EXPECT_EQ(2.5, store.Cell(d).Real());
+   EXPECT_EQ(SimpleConfig::Value::NUMBER_BITS, store.Cell(b).GetStorage());
+   EXPECT_EQ("true", store.Text(b));
+}
+
+//Converting these would lose the source text, and 2.0 would read back
+//as the integer 2
+TEST(ValueStoreTest, NonCanonicalNumbersKeepText)
+{
+   SimpleConfig::ValueStore store;
+   const char* integers[] = {"0x10", "010", "+5", "-0"};
+   for(size_t n = 0; n < sizeof(integers) / sizeof(integers[0]); n++)
+   {
+      size_t i = store.Add(MakeToken(SimpleConfig::INTEGER, integers[n], 1));
+      EXPECT_EQ(SimpleConfig::Value::INLINE_TEXT, store.Cell(i).GetStorage()) << integers[n];
+      EXPECT_EQ(integers[n], store.Text(i));
+      EXPECT_EQ(SimpleConfig::INTEGER, store.Type(i));
+   }
+   const char* reals[] = {"2.0", "1.10", "1e3"};
+   for(size_t n = 0; n < sizeof(reals) / sizeof(reals[0]); n++)
+   {
+      size_t d = store.Add(MakeToken(SimpleConfig::REAL_NUMBER, reals[n], 1));
+      EXPECT_EQ(reals[n], store.Text(d));
+      EXPECT_EQ(SimpleConfig::REAL_NUMBER, store.Type(d));
+   }
+   size_t b = store.Add(MakeToken(SimpleConfig::BOOL, "TRUE", 1));
+   EXPECT_EQ("TRUE", store.Text(b));
+   EXPECT_EQ(SimpleConfig::BOOL, store.Type(b));
+}
+
+TEST(ValueStoreTest, OutOfRangeNumberKeepsText)
+{
+   SimpleConfig::ValueStore store;
+   size_t i = store.Add(MakeToken(SimpleConfig::INTEGER, "99999999999999999999", 1));
+   EXPECT_EQ("99999999999999999999", store.Text(i));
+   EXPECT_EQ(SimpleConfig::INTEGER, store.Type(i));
+}
+
+TEST(ValueStoreTest, TextDataMatchesText)
+{
+   SimpleConfig::ValueStore store;
+   SimpleConfig::ListValue list;
+   list.text = "[1, 2]";
+   store.Add(MakeToken(SimpleConfig::INTEGER, "-42", 1));
+   store.Add(MakeToken(SimpleConfig::REAL_NUMBER, "0.1", 1));
+   store.Add(MakeToken(SimpleConfig::BOOL, "false", 1));
+   store.Add(MakeToken(SimpleConfig::INTEGER, "0x2A", 1));
+   store.Add(MakeToken(SimpleConfig::STRING, std::string(30, 's'), 1));
+   store.AddList(list, 1);
+
+   char scratch[SimpleConfig::NUMBER_TEXT_SIZE];
+   for(size_t i = 0; i < store.Size(); i++)
+   {
+      size_t length;
+      const char* data = store.TextData(i, scratch, length);
+      EXPECT_EQ(store.Text(i), std::string(data, length));
+   }
+}
+
+TEST(ValueStoreTest, ShortAndLongStringsRoundTrip)
+{
+   SimpleConfig::ValueStore store;
+   std::string longText(100, 'x');
+   size_t s = store.Add(MakeToken(SimpleConfig::STRING, "short", 1));
+   size_t l = store.Add(MakeToken(SimpleConfig::STRING, longText, 2));
+
+   EXPECT_EQ(SimpleConfig::Value::INLINE_TEXT, store.Cell(s).GetStorage());
+   EXPECT_EQ(SimpleConfig::Value::POOLED_TEXT, store.Cell(l).GetStorage());
+   EXPECT_EQ("short", store.Text(s));
+   EXPECT_EQ(longText, store.Text(l));
+
+   SimpleConfig::ValueStore copy(store);
+   EXPECT_EQ(longText, copy.Text(l));
+}
+
+TEST(ValueStoreTest, ExternalStringsAreNotCopied)
+{
+   SimpleConfig::ValueStore store;
+   std::string longText(40, 'y');
+   size_t l = store.Add(MakeToken(SimpleConfig::STRING, longText, 1), longText.data());
+   EXPECT_EQ(SimpleConfig::Value::EXTERNAL_TEXT, store.Cell(l).GetStorage());
+   EXPECT_EQ(longText.data(), store.Cell(l).ExternalText());
+   EXPECT_EQ(longText, store.Text(l));
+}
+
+TEST(ValueStoreTest, LinesComeFromSideTable)
+{
+   SimpleConfig::ValueStore store;
+   size_t a = store.Add(MakeToken(SimpleConfig::STRING, "a", 7));
+   store.Set(a, MakeToken(SimpleConfig::INTEGER, "5", 9));
+
+   SimpleConfig::Token tok = store.Get(a);
+   EXPECT_EQ(9, store.Line(a));
+   EXPECT_EQ(9, tok.lineNum);
+   EXPECT_EQ(SimpleConfig::INTEGER, tok.type);
+   EXPECT_EQ("5", tok.lexeme);
+}
+
+TEST(ValueStoreTest, EqualsComparesAcrossStores)
+{
+   SimpleConfig::ValueStore a;
+   SimpleConfig::ValueStore b;
+   std::string longText(30, 'z');
+   a.Add(MakeToken(SimpleConfig::INTEGER, "10", 1));
+   b.Add(MakeToken(SimpleConfig::INTEGER, "10", 8));
+   a.Add(MakeToken(SimpleConfig::STRING, longText, 2));
+   b.Add(MakeToken(SimpleConfig::STRING, longText, 2));
+   a.Add(MakeToken(SimpleConfig::STRING, "1", 3));
+
+   EXPECT_TRUE(a.Equals(0, b, 0));
+   EXPECT_TRUE(a.Equals(1, b, 1));
+   EXPECT_FALSE(a.Equals(2, b, 0));
+
+   b.Add(MakeToken(SimpleConfig::INTEGER, "0xA", 8));
+   EXPECT_FALSE(a.Equals(0, b, 2)); //Values compare as written
+}
+
+
+TEST(ValueStoreTest, ClearReusesListSlots)
+{
+   SimpleConfig::ValueStore store;
+   SimpleConfig::ListValue list;
+   list.text = "[1]";
+   list.elements.push_back(MakeToken(SimpleConfig::INTEGER, "1", 1));
+   list.integers.push_back(1);
+   store.Add(MakeToken(SimpleConfig::INTEGER, "7", 1));
+   store.AddList(list, 2);
+   EXPECT_TRUE(list.elements.empty());
+
+   store.Clear();
+   EXPECT_EQ(0u, store.Size());
+   SimpleConfig::ListValue other;
+   other.text = "[]";
+   size_t index = store.AddList(other, 4);
+   EXPECT_EQ(0u, index);
+   EXPECT_EQ("[]", store.Text(index));
+   EXPECT_EQ(4, store.Line(index));
+   EXPECT_EQ(1u, other.elements.size()); //The old slot's buffers, handed back
+}
+
+//Reassigning a key must not leave its old list slot or pooled text behind
+TEST(ValueStoreTest, SetReusesReplacedStorage)
+{
+   SimpleConfig::ValueStore store;
+   std::string longText(40, 'x');
+   size_t s = store.Add(MakeToken(SimpleConfig::STRING, longText, 1));
+   SimpleConfig::ListValue list;
+   list.text = "[1]";
+   size_t l = store.AddList(list, 2);
+   size_t usage = store.MemoryUsage();
+
+   for(int i = 0; i < 100; i++)
+   {
+      store.Set(s, MakeToken(SimpleConfig::STRING, std::string(30 + i % 10, 'y'), 3));
+      SimpleConfig::ListValue next;
+      next.text = "[2]";
+      store.SetList(l, next, 4);
+   }
+   EXPECT_EQ(usage, store.MemoryUsage());
+   EXPECT_EQ(std::string(39, 'y'), store.Text(s));
+   EXPECT_EQ("[2]", store.Text(l));
+
+   //A list replaced by a scalar frees its slot for the next list
+   store.Set(l, MakeToken(SimpleConfig::INTEGER, "1", 5));
+   SimpleConfig::ListValue last;
+   last.text = "[3]";
+   size_t added = store.AddList(last, 6);
+   EXPECT_EQ("[3]", store.Text(added));
+   EXPECT_EQ(1, store.Cell(l).Integer());
+}
+
+}